@@ -0,0 +1,146 @@
+#include <errno.h>
+#include <string.h>
+
+#include "charlieplex_driver.h"
+#include "charlieplex_luts.h"
+#include "emulator.h"
+
+/*
+ * Stand-in for the charlieplex driver. A frame is kept as a brightness per
+ * led instead of a scan-out table, and a scan is played out in one call
+ * instead of over N_SCAN_STEPS timer interrupts.
+ */
+struct charlieplex_emulator_context {
+    uint8_t front[N_DIMENSIONS][N_DIMENSIONS];  // On display
+    uint8_t back[N_DIMENSIONS][N_DIMENSIONS];   // Waiting to be swapped in
+    bool update_requested;
+    bool paused;
+
+    uint32_t refresh_rate;
+    uint32_t duty;
+
+    struct charlieplex_driver_stats stats;
+};
+
+static struct charlieplex_emulator_context context = {
+    .refresh_rate = CHARLIEPLEX_REFRESH_RATE,
+    .duty = CHARLIEPLEX_DUTY_FULL,
+};
+
+void charlieplex_driver_init(void) {
+    context = (struct charlieplex_emulator_context){
+        .refresh_rate = CHARLIEPLEX_REFRESH_RATE,
+        .duty = CHARLIEPLEX_DUTY_FULL,
+    };
+}
+
+void charlieplex_driver_reset_pins(void) {
+}
+
+void charlieplex_driver_draw_planes(const struct charlieplex_planes *planes) {
+    uint8_t *leds = &context.back[0][0];
+
+    if (context.update_requested) {
+        context.stats.n_dropped++;
+    }
+
+    for (uint32_t bit = 0; bit < N_DIMENSIONS * N_DIMENSIONS; bit++) {
+        uint8_t brightness = 0;
+
+        for (int b = 0; b < CHARLIEPLEX_BRIGHTNESS_BITS; b++) {
+            brightness |= ((planes->word[b][bit / 32U] >> (bit % 32U)) & 1U)
+                          << b;
+        }
+        leds[bit] = brightness > CHARLIEPLEX_MAX_BRIGHTNESS
+                        ? CHARLIEPLEX_MAX_BRIGHTNESS
+                        : brightness;
+    }
+
+    context.stats.n_draws++;
+    context.update_requested = true;
+}
+
+bool charlieplex_driver_is_pending(void) {
+    return context.update_requested;
+}
+
+void charlieplex_driver_draw(uint8_t *leds) {
+    struct charlieplex_planes planes;
+
+    // Skip the dummy led
+    charlieplex_planes_pack(&planes, &leds[1]);
+    charlieplex_driver_draw_planes(&planes);
+}
+
+/* Only the ranges are checked, there are no timer periods to work out */
+int charlieplex_driver_set_timing(uint32_t refresh_rate, uint32_t duty) {
+    if (refresh_rate == 0 || refresh_rate > CHARLIEPLEX_REFRESH_RATE ||
+        duty > CHARLIEPLEX_DUTY_FULL) {
+        return -EINVAL;
+    }
+
+    context.refresh_rate = refresh_rate;
+    context.duty = duty;
+
+    return 0;
+}
+
+void charlieplex_driver_get_stats(struct charlieplex_driver_stats *stats) {
+    *stats = context.stats;
+}
+
+void pause_charlieplex_driver(void) {
+    context.paused = true;
+}
+
+void unpause_charlieplex_driver(void) {
+    context.paused = false;
+}
+
+/*
+ * A subframe takes three timer ticks, as in the real driver, and the timer
+ * ticks at CHARLIEPLEX_TICK_RATE when running at the full refresh rate.
+ * Rounded to the nearest millisecond.
+ */
+uint32_t charlieplex_emulator_frame_ms(void) {
+    uint32_t tick_rate =
+        CHARLIEPLEX_TICK_RATE * context.refresh_rate / CHARLIEPLEX_REFRESH_RATE;
+
+    return (__NUM_LED_FRAMES * 3U * 1000U + tick_rate / 2U) / tick_rate;
+}
+
+void charlieplex_emulator_scan(void) {
+    if (context.paused) {
+        return;
+    }
+
+    if (context.update_requested) {
+        memcpy(context.front, context.back, sizeof(context.front));
+        context.update_requested = false;
+        context.stats.n_shown++;
+    } else {
+        context.stats.n_repeats++;
+    }
+}
+
+void charlieplex_emulator_get_frame(
+    uint8_t frame[N_DIMENSIONS][N_DIMENSIONS]) {
+    memcpy(frame, context.front, sizeof(context.front));
+}
+
+void charlieplex_emulator_get_on_time(
+    uint8_t on_time[N_DIMENSIONS][N_DIMENSIONS]) {
+    const uint32_t max_code = (1U << CHARLIEPLEX_N_PLANES) - 1U;
+
+    for (uint32_t n = 0; n < N_DIMENSIONS * N_DIMENSIONS; n++) {
+        uint8_t level = context.front[n / N_DIMENSIONS][n % N_DIMENSIONS];
+#if CHARLIEPLEX_LUT_CALIBRATED
+        uint32_t code = charlieplex_led_code_lut[n][level];
+#else
+        uint32_t code = charlieplex_code_lut[level];
+#endif
+
+        on_time[n / N_DIMENSIONS][n % N_DIMENSIONS] =
+            code * context.duty / max_code;
+    }
+}
@@ -0,0 +1,763 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "display_brightness.h"
+#include "display_telemetry.h"
+#include "emulator.h"
+#include "game_entity.h"
+#include "led_matrix.h"
+#include "physics_engine_environment.h"
+#include "physics_engine_events.h"
+#include "ring_buffer.h"
+#include "space_invaders_game.h"
+#include "system_communication.h"
+
+extern struct driver_comm_shared_memory led_matrix_comm;
+extern struct driver_comm_message_passing ambient_light_comm;
+extern volatile bool update_requested;
+
+/*
+ * Runs the led matrix pipeline on the host and dumps the frames the driver
+ * would have shown.
+ *
+ * Time is simulated a millisecond at a time. Each millisecond plays the
+ * part of the widget controller and the game engine, then runs every stage
+ * of the pipeline for as long as one is ready, as the job queue would. The
+ * driver scans out a frame every charlieplex_emulator_frame_ms().
+ *
+ * The ambient light sensor always reads the lux given on the command line,
+ * and the display brightness controller runs on it as on the device.
+ */
+
+enum emulator_scene {
+    EMULATOR_SCENE_ANIMATION,  // The packed test animation
+    EMULATOR_SCENE_TEXT,       // Scrolling text over an empty game
+    EMULATOR_SCENE_BOUNCE,     // Balls moved by the physics engine
+    EMULATOR_SCENE_BRICKS,     // A ball knocking out a wall of bricks
+    EMULATOR_SCENE_INVADERS,   // A space invaders wave under fire
+};
+
+enum emulator_output {
+    EMULATOR_OUTPUT_NONE,
+    EMULATOR_OUTPUT_ASCII,
+    EMULATOR_OUTPUT_PPM,
+};
+
+/* Balls in the bounce scene, at most one per cell to start from */
+#define EMULATOR_N_BALLS 4
+#define EMULATOR_MAX_BALLS (N_DIMENSIONS * N_DIMENSIONS)
+
+/*
+ * Bricks in the wall of the bricks scene, four rows as in brick breaker. The
+ * wall can fill every row but the bottom one, where the ball starts.
+ */
+#define EMULATOR_N_BRICKS (4 * N_DIMENSIONS)
+#define EMULATOR_MAX_BRICKS ((N_DIMENSIONS - 1) * N_DIMENSIONS)
+
+#define EMULATOR_MAX_ENTITIES EMULATOR_MAX_BALLS
+
+/* Upper bound on stage runs per millisecond, in case a stage never idles */
+#define EMULATOR_MAX_RUNS_PER_MS 32
+
+/* Size of an led in the PPM images, in pixels */
+#define EMULATOR_PPM_SCALE 8
+
+struct emulator_stage {
+    const char *name;
+    void (*run)(void);
+    bool (*is_ready)(void);
+
+    uint64_t n_runs;
+    uint64_t cycles;
+    uint64_t max_cycles;
+};
+
+static struct emulator_stage stages[] = {
+    {"led_loader", &led_matrix_loader_run, &led_matrix_loader_is_ready},
+    {"led_renderer", &led_matrix_renderer_run, &led_matrix_renderer_is_ready},
+    {"led_compositor", &led_matrix_compositor_run,
+     &led_matrix_compositor_is_ready},
+    {"led_assembler", &led_matrix_assembler_run,
+     &led_matrix_assembler_is_ready},
+};
+
+#define EMULATOR_N_STAGES (sizeof(stages) / sizeof(stages[0]))
+
+struct emulator_options {
+    enum emulator_scene scene;
+    enum emulator_output output;
+    const char *text;
+    const char *prefix;  // Path prefix of the PPM images
+    uint32_t n_frames;
+    uint32_t n_objects;  // Balls or bricks, 0 for the scene's default
+    bool swept;          // Balls use the swept collision check
+    uint32_t tick_ms;    // Fixed physics step, 0 for one update per frame
+    int32_t lux;  // Ambient light, or -1 to leave the display at full duty
+};
+
+struct emulator_context {
+    struct emulator_options options;
+
+    struct physics_engine_environment environment;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(EMULATOR_MAX_ENTITIES)
+        environment_storage;
+    struct physics_engine_event events[EVENT_QUEUE_SIZE];
+    struct ring_buffer event_queue;
+    struct game_entity entities[EMULATOR_MAX_ENTITIES];
+    uint32_t n_entities;
+    uint32_t last_update;
+    uint32_t n_physics_updates;
+    uint64_t physics_cycles;
+    uint64_t max_physics_cycles;
+
+    uint64_t frame_cycles;  // Spent by the pipeline since the last scan
+    uint64_t total_frame_cycles;
+    uint64_t max_frame_cycles;
+};
+
+static struct emulator_context context;
+
+static const velocity ball_velocities[] = {
+    {37, 23}, {-29, 41}, {19, -33}, {-43, -17},
+};
+
+#define EMULATOR_N_VELOCITIES \
+    (sizeof(ball_velocities) / sizeof(ball_velocities[0]))
+
+/* Adds an active entity drawn as a small ball */
+static int emulator_add_entity(struct entity_init_struct *init_struct) {
+    struct game_entity *game_entity = &context.entities[context.n_entities];
+
+    struct entity_creation_result result =
+        add_entity(&context.environment, init_struct);
+    if (result.error != ENTITY_CREATION_SUCCESS) {
+        fprintf(stderr, "Failed to create entity %u: %d\n", context.n_entities,
+                result.error);
+        return -EINVAL;
+    }
+
+    game_entity_init(game_entity, result.entity, &small_ball);
+    activate_game_entity(game_entity);
+    context.n_entities++;
+
+    return 0;
+}
+
+static int emulator_bounce_setup(void) {
+    // Balls go down the diagonal, one cell further right on each pass of the
+    // rows, so no two start in the same cell
+    uint32_t n_balls = context.options.n_objects ? context.options.n_objects
+                                                 : EMULATOR_N_BALLS;
+
+    for (uint32_t i = 0; i < n_balls; i++) {
+        int x = (1 + i + i / N_DIMENSIONS) % N_DIMENSIONS;
+        int y = (1 + i) % N_DIMENSIONS;
+        struct entity_init_struct init_struct = {
+            .rectangle = {TOP_LEFT_POSITION_FROM_GRID(x, y),
+                          BOTTOM_RIGHT_POSITION_FROM_GRID(x, y)},
+            .velocity = ball_velocities[i % EMULATOR_N_VELOCITIES],
+            .mass = SMALL_MASS,
+            .solid = true,
+            .swept = context.options.swept,
+        };
+
+        int ret = emulator_add_entity(&init_struct);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/* The ball comes first, as in brick breaker, then the wall row by row */
+static int emulator_bricks_setup(void) {
+    uint32_t n_bricks = context.options.n_objects ? context.options.n_objects
+                                                  : EMULATOR_N_BRICKS;
+    struct entity_init_struct ball_init_struct = {
+        .rectangle = {TOP_LEFT_POSITION_FROM_GRID(3, N_DIMENSIONS - 1),
+                      BOTTOM_RIGHT_POSITION_FROM_GRID(3, N_DIMENSIONS - 1)},
+        .velocity = {13, 29},
+        .mass = LARGE_MASS,
+        .solid = true,
+        .swept = context.options.swept,
+    };
+
+    int ret = emulator_add_entity(&ball_init_struct);
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < n_bricks; i++) {
+        int x = i % N_DIMENSIONS;
+        int y = i / N_DIMENSIONS;
+        struct entity_init_struct brick_init_struct = {
+            .rectangle = {TOP_LEFT_POSITION_FROM_GRID(x, y),
+                          BOTTOM_RIGHT_POSITION_FROM_GRID(x, y)},
+            .mass = INFINITE_MASS,
+            .solid = true,
+        };
+
+        ret = emulator_add_entity(&brick_init_struct);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * The space invaders wave as the game starts it, with every bullet in
+ * flight: user bullets going up into the wave and enemy bullets coming down
+ * through it. Bullets bounce off the edges, so the wave stays under fire.
+ */
+static int emulator_invaders_setup(void) {
+    struct entity_init_struct init_struct =
+        space_invaders_user_ship_init_struct;
+
+    int ret = emulator_add_entity(&init_struct);
+    if (ret != 0) {
+        return ret;
+    }
+
+    init_struct = space_invaders_enemy_ship_init_struct;
+    for (int i = 0; i < SPACE_INVADERS_NUM_OF_ENEMY_SHIPS; i++) {
+        init_struct.rectangle = (struct rectangle){
+            SPACE_INVADERS_ENEMY_SHIP_START_POSITION(i)};
+
+        ret = emulator_add_entity(&init_struct);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    init_struct = space_invaders_user_bullet_init_struct;
+    for (int i = 0; i < SPACE_INVADERS_MAX_USER_BULLETS; i++) {
+        int x = (i * 2) % N_DIMENSIONS;
+        init_struct.rectangle = (struct rectangle){
+            TOP_LEFT_POSITION_FROM_GRID(x, N_DIMENSIONS - 2),
+            BOTTOM_RIGHT_POSITION_FROM_GRID(x, N_DIMENSIONS - 2)};
+
+        ret = emulator_add_entity(&init_struct);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    init_struct = space_invaders_enemy_bullet_init_struct;
+    for (int i = 0; i < SPACE_INVADERS_MAX_ENEMY_BULLETS; i++) {
+        int x = (i * 2 + 1) % N_DIMENSIONS;
+        init_struct.rectangle =
+            (struct rectangle){TOP_LEFT_POSITION_FROM_GRID(x, 3),
+                               BOTTOM_RIGHT_POSITION_FROM_GRID(x, 3)};
+
+        ret = emulator_add_entity(&init_struct);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int emulator_physics_setup(void) {
+    int ret = ring_buffer_init(&context.event_queue, context.events,
+                               sizeof(context.events[0]), EVENT_QUEUE_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context.environment,
+                                    &context.environment_storage);
+    if (context.options.tick_ms > 0) {
+        physics_engine_environment_set_tick(&context.environment,
+                                            context.options.tick_ms);
+    }
+
+    switch (context.options.scene) {
+        case EMULATOR_SCENE_BRICKS:
+            ret = emulator_bricks_setup();
+            break;
+        case EMULATOR_SCENE_INVADERS:
+            ret = emulator_invaders_setup();
+            break;
+        default:
+            ret = emulator_bounce_setup();
+            break;
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    led_matrix_comm.data.led_matrix.renderer.entities = context.entities;
+    led_matrix_comm.data.led_matrix.renderer.num_entities = context.n_entities;
+
+    return 0;
+}
+
+/*
+ * A brick the ball hits is knocked out, and the wall is put back up once
+ * the last one is
+ */
+static void emulator_bricks_hit(struct entity *brick) {
+    deactivate_game_entity(&context.entities[brick->entity_idx]);
+
+    // The ball is the one entity left live
+    if (context.environment.num_live > 1) {
+        return;
+    }
+
+    for (uint32_t i = 1; i < context.n_entities; i++) {
+        activate_game_entity(&context.entities[i]);
+    }
+}
+
+static bool emulator_scene_has_physics(enum emulator_scene scene) {
+    return scene == EMULATOR_SCENE_BOUNCE || scene == EMULATOR_SCENE_BRICKS ||
+           scene == EMULATOR_SCENE_INVADERS;
+}
+
+/* Bounces the entities off the edges, the physics engine handles the rest */
+static void emulator_physics_events(void) {
+    struct physics_engine_event event;
+
+    while (ring_buffer_pop(&context.event_queue, &event) == 0) {
+        if (event.type == COLLISION_EVENT) {
+            if (context.options.scene == EMULATOR_SCENE_BRICKS) {
+                emulator_bricks_hit(event.collision_event.ent2);
+            }
+            continue;
+        }
+
+        struct entity *ent = event.out_of_bounds_event.ent;
+        velocity v = get_entity_velocity(ent);
+        switch (event.out_of_bounds_event.type) {
+            case OUT_OF_BOUNDS_LEFT:
+            case OUT_OF_BOUNDS_RIGHT:
+                v.x = -v.x;
+                break;
+            case OUT_OF_BOUNDS_TOP:
+            case OUT_OF_BOUNDS_BOTTOM:
+                v.y = -v.y;
+                break;
+        }
+        set_entity_velocity(ent, v);
+    }
+}
+
+/*
+ * Runs the physics steps due for delta_t, handling each step's events
+ * before the next as the game engine does, then syncs the sprites.
+ */
+static void emulator_physics_update(uint32_t delta_t) {
+    uint32_t n_steps = 1;
+    uint32_t step_ms = delta_t;
+
+    if (context.options.tick_ms > 0) {
+        n_steps = physics_engine_environment_accumulate(&context.environment,
+                                                        delta_t * 1000U);
+        step_ms = context.environment.tick_ms;
+    }
+
+    for (uint32_t n = 0; n < n_steps; n++) {
+        uint64_t t0 = emulator_cycles();
+        physics_engine_environment_update(&context.event_queue,
+                                          &context.environment, step_ms);
+        uint64_t cycles = emulator_cycles() - t0;
+
+        context.n_physics_updates++;
+        context.physics_cycles += cycles;
+        if (cycles > context.max_physics_cycles) {
+            context.max_physics_cycles = cycles;
+        }
+
+        emulator_physics_events();
+    }
+
+    game_entities_sync_sprites(context.entities, &context.environment);
+}
+
+static int emulator_setup(void) {
+    __typeof__(led_matrix_comm.data.led_matrix) *led_matrix =
+        &led_matrix_comm.data.led_matrix;
+
+    led_matrix_setup();
+
+    if (context.options.lux < 0) {
+        display_brightness_enable(false);
+    } else {
+        ambient_light_comm.data.ambient_light.als = context.options.lux;
+        ambient_light_comm.data.ambient_light.valid = true;
+    }
+
+    bool animation = context.options.scene == EMULATOR_SCENE_ANIMATION;
+    led_matrix->loader.active = animation;
+    led_matrix->loader.input_anim = ANIM_TEST_ANIMATION;
+    led_matrix->renderer.active = !animation;
+    led_matrix->assembler.active = true;
+
+    // Set to finished so the first millisecond gives them work
+    led_matrix->loader.finished = true;
+    led_matrix->renderer.finished = true;
+    led_matrix->assembler.finished = true;
+
+    if (emulator_scene_has_physics(context.options.scene)) {
+        return emulator_physics_setup();
+    }
+
+    return 0;
+}
+
+/* Hands the stages new work, as update_led_matrix() in the widget does */
+static void emulator_widget_update(void) {
+    __typeof__(led_matrix_comm.data.led_matrix) *led_matrix =
+        &led_matrix_comm.data.led_matrix;
+
+    if (led_matrix->loader.finished) {
+        led_matrix->loader.finished = false;
+
+        led_matrix->loader.input_frame++;
+        if (led_matrix->loader.input_frame >=
+            get_anim_length(led_matrix->loader.input_anim)) {
+            led_matrix->loader.input_frame = 0;
+        }
+    }
+
+    if (led_matrix->renderer.finished) {
+        led_matrix->renderer.finished = false;
+    }
+
+    if (led_matrix->assembler.finished) {
+        led_matrix->assembler.finished = false;
+    }
+}
+
+/* Steps the scene once per rendered frame, as game_engine_run() does */
+static void emulator_game_update(void) {
+    if (!update_requested) {
+        return;
+    }
+
+    uint32_t delta_t = HAL_GetTick() - context.last_update;
+    context.last_update = HAL_GetTick();
+
+    switch (context.options.scene) {
+        case EMULATOR_SCENE_TEXT:
+            led_matrix_scroll_text(context.options.text,
+                                   SCROLL_SPEED_MODERATE);
+            break;
+        case EMULATOR_SCENE_BOUNCE:
+        case EMULATOR_SCENE_BRICKS:
+        case EMULATOR_SCENE_INVADERS:
+            emulator_physics_update(delta_t);
+            break;
+        case EMULATOR_SCENE_ANIMATION:
+            break;
+    }
+
+    update_requested = false;
+    display_telemetry_mark_update();
+}
+
+static void emulator_run_stages(void) {
+    for (int n = 0; n < EMULATOR_MAX_RUNS_PER_MS; n++) {
+        bool ran = false;
+
+        for (size_t i = 0; i < EMULATOR_N_STAGES; i++) {
+            struct emulator_stage *stage = &stages[i];
+
+            if (!stage->is_ready()) {
+                continue;
+            }
+
+            uint64_t t0 = emulator_cycles();
+            stage->run();
+            uint64_t cycles = emulator_cycles() - t0;
+
+            stage->n_runs++;
+            stage->cycles += cycles;
+            if (cycles > stage->max_cycles) {
+                stage->max_cycles = cycles;
+            }
+            context.frame_cycles += cycles;
+            ran = true;
+        }
+
+        if (!ran) {
+            return;
+        }
+    }
+}
+
+static void emulator_print_ascii(uint32_t n,
+                                 uint8_t frame[N_DIMENSIONS][N_DIMENSIONS]) {
+    static const char levels[CHARLIEPLEX_MAX_BRIGHTNESS + 1] = " .:*#";
+
+    printf("frame %u at %u ms\n", n, HAL_GetTick());
+    for (int row = 0; row < N_DIMENSIONS; row++) {
+        putchar('|');
+        for (int col = 0; col < N_DIMENSIONS; col++) {
+            putchar(levels[frame[row][col]]);
+            putchar(levels[frame[row][col]]);
+        }
+        puts("|");
+    }
+}
+
+/* Leds are drawn red, as bright as the part of the tick they are lit for */
+static int emulator_write_ppm(uint32_t n) {
+    const int size = N_DIMENSIONS * EMULATOR_PPM_SCALE;
+    uint8_t on_time[N_DIMENSIONS][N_DIMENSIONS];
+    char path[4096];
+
+    charlieplex_emulator_get_on_time(on_time);
+
+    snprintf(path, sizeof(path), "%s%05u.ppm", context.options.prefix, n);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        return -EIO;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint8_t pixel[3] = {
+                on_time[y / EMULATOR_PPM_SCALE][x / EMULATOR_PPM_SCALE], 0, 0};
+
+            fwrite(pixel, sizeof(pixel), 1, file);
+        }
+    }
+
+    return fclose(file) == 0 ? 0 : -EIO;
+}
+
+static int emulator_scan(uint32_t n) {
+    uint8_t frame[N_DIMENSIONS][N_DIMENSIONS];
+
+    charlieplex_emulator_scan();
+    charlieplex_emulator_get_frame(frame);
+
+    context.total_frame_cycles += context.frame_cycles;
+    if (context.frame_cycles > context.max_frame_cycles) {
+        context.max_frame_cycles = context.frame_cycles;
+    }
+    context.frame_cycles = 0;
+
+    switch (context.options.output) {
+        case EMULATOR_OUTPUT_ASCII:
+            emulator_print_ascii(n, frame);
+            break;
+        case EMULATOR_OUTPUT_PPM:
+            return emulator_write_ppm(n);
+        case EMULATOR_OUTPUT_NONE:
+            break;
+    }
+
+    return 0;
+}
+
+static void emulator_print_report(void) {
+    struct charlieplex_driver_stats driver_stats;
+    struct led_matrix_frame_stats frame_stats;
+    struct display_telemetry telemetry;
+    uint32_t n_frames = context.options.n_frames;
+
+    charlieplex_driver_get_stats(&driver_stats);
+    led_matrix_get_frame_stats(&frame_stats);
+    display_telemetry_get(&telemetry);
+
+    fprintf(stderr, "%-16s %8s %12s %10s %10s\n", "stage", "runs", "cycles",
+            "mean", "max");
+    for (size_t i = 0; i < EMULATOR_N_STAGES; i++) {
+        const struct emulator_stage *stage = &stages[i];
+
+        fprintf(stderr, "%-16s %8llu %12llu %10llu %10llu\n", stage->name,
+                (unsigned long long)stage->n_runs,
+                (unsigned long long)stage->cycles,
+                (unsigned long long)(stage->n_runs
+                                         ? stage->cycles / stage->n_runs
+                                         : 0),
+                (unsigned long long)stage->max_cycles);
+    }
+
+    fprintf(stderr, "per frame: mean %llu max %llu cycles (%u Hz counter)\n",
+            (unsigned long long)(context.total_frame_cycles / n_frames),
+            (unsigned long long)context.max_frame_cycles, SystemCoreClock);
+    uint32_t duty, refresh_rate;
+    display_brightness_get(&duty, &refresh_rate);
+
+    fprintf(stderr,
+            "display: duty %u refresh %u Hz\n"
+            "driver: draws %u shown %u repeats %u dropped %u\n"
+            "frames: processed %u skipped %u underruns %u\n"
+            "latency: p50 %uus p99 %uus\n",
+            duty, refresh_rate, driver_stats.n_draws, driver_stats.n_shown,
+            driver_stats.n_repeats, driver_stats.n_dropped,
+            frame_stats.n_processed, frame_stats.n_skipped,
+            frame_stats.n_underruns, telemetry.latency_p50_us,
+            telemetry.latency_p99_us);
+
+    if (emulator_scene_has_physics(context.options.scene)) {
+        uint32_t n_updates = context.n_physics_updates;
+
+        fprintf(stderr,
+                "physics: updates %u pair tests %u (%u per update)\n"
+                "physics: per update mean %llu max %llu cycles\n",
+                n_updates, context.environment.n_pair_tests,
+                n_updates ? context.environment.n_pair_tests / n_updates : 0,
+                (unsigned long long)(n_updates ? context.physics_cycles /
+                                                     n_updates
+                                               : 0),
+                (unsigned long long)context.max_physics_cycles);
+    }
+}
+
+static void emulator_usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-s animation|text|bounce|bricks|invaders] [-t text]\n"
+            "          [-n frames] [-f ascii|ppm|none] [-o prefix] [-l lux]\n"
+            "          [-b count] [-c] [-p ms]\n"
+            "  -s  scene to run (animation)\n"
+            "  -t  text scrolled by the text scene\n"
+            "  -n  number of frames to scan out (100)\n"
+            "  -f  how frames are dumped, ascii to stdout or ppm images\n"
+            "  -o  path prefix of the ppm images (frame_)\n"
+            "  -l  ambient light in lux, full duty if unset\n"
+            "  -b  number of balls in the bounce scene (4), or of bricks in\n"
+            "      the bricks scene (28)\n"
+            "  -c  balls collide along their path, not only where they land\n"
+            "  -p  fixed physics step in ms, one update per frame if unset\n",
+            name);
+}
+
+static int emulator_parse_options(int argc, char **argv,
+                                  struct emulator_options *options) {
+    static const char *const scenes[] = {
+        [EMULATOR_SCENE_ANIMATION] = "animation",
+        [EMULATOR_SCENE_TEXT] = "text",
+        [EMULATOR_SCENE_BOUNCE] = "bounce",
+        [EMULATOR_SCENE_BRICKS] = "bricks",
+        [EMULATOR_SCENE_INVADERS] = "invaders",
+    };
+    const size_t n_scenes = sizeof(scenes) / sizeof(scenes[0]);
+    static const char *const outputs[] = {
+        [EMULATOR_OUTPUT_NONE] = "none",
+        [EMULATOR_OUTPUT_ASCII] = "ascii",
+        [EMULATOR_OUTPUT_PPM] = "ppm",
+    };
+    int opt;
+
+    *options = (struct emulator_options){
+        .scene = EMULATOR_SCENE_ANIMATION,
+        .output = EMULATOR_OUTPUT_ASCII,
+        .text = " HAPPY HOLIDAYS!",
+        .prefix = "frame_",
+        .n_frames = 100,
+        .lux = -1,
+    };
+
+    while ((opt = getopt(argc, argv, "s:t:n:f:o:l:b:cp:h")) != -1) {
+        switch (opt) {
+            case 's': {
+                size_t i = 0;
+                while (i < n_scenes && strcmp(optarg, scenes[i]) != 0) {
+                    i++;
+                }
+                if (i == n_scenes) {
+                    return -EINVAL;
+                }
+                options->scene = i;
+            } break;
+            case 'f': {
+                size_t i = 0;
+                while (i < 3 && strcmp(optarg, outputs[i]) != 0) {
+                    i++;
+                }
+                if (i == 3) {
+                    return -EINVAL;
+                }
+                options->output = i;
+            } break;
+            case 't':
+                options->text = optarg;
+                break;
+            case 'n':
+                options->n_frames = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                options->n_objects = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                options->swept = true;
+                break;
+            case 'p':
+                options->tick_ms = strtoul(optarg, NULL, 0);
+                if (options->tick_ms == 0) {
+                    return -EINVAL;
+                }
+                break;
+            case 'o':
+                options->prefix = optarg;
+                break;
+            case 'l':
+                options->lux = strtol(optarg, NULL, 0);
+                if (options->lux < 0 || options->lux > UINT16_MAX) {
+                    return -EINVAL;
+                }
+                break;
+            default:
+                return -EINVAL;
+        }
+    }
+
+    if (options->scene == EMULATOR_SCENE_BOUNCE &&
+        options->n_objects > EMULATOR_MAX_BALLS) {
+        return -EINVAL;
+    }
+    if (options->scene == EMULATOR_SCENE_BRICKS &&
+        options->n_objects > EMULATOR_MAX_BRICKS) {
+        return -EINVAL;
+    }
+
+    return options->n_frames > 0 ? 0 : -EINVAL;
+}
+
+int main(int argc, char **argv) {
+    if (emulator_parse_options(argc, argv, &context.options) < 0) {
+        emulator_usage(argv[0]);
+        return 1;
+    }
+
+    emulator_calibrate_clock();
+
+    if (emulator_setup() < 0) {
+        return 1;
+    }
+
+    for (uint32_t n = 0; n < context.options.n_frames; n++) {
+        uint32_t frame_ms = charlieplex_emulator_frame_ms();
+
+        for (uint32_t ms = 0; ms < frame_ms; ms++) {
+            emulator_widget_update();
+            emulator_game_update();
+            emulator_run_stages();
+            if (HAL_GetTick() % DISPLAY_BRIGHTNESS_PERIOD_MS == 0) {
+                display_brightness_run();
+            }
+            emulator_advance_ms(1);
+        }
+
+        if (emulator_scan(n) < 0) {
+            return 1;
+        }
+    }
+
+    emulator_print_report();
+
+    return 0;
+}
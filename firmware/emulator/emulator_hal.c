@@ -0,0 +1,103 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "emulator.h"
+#include "job_queue.h"
+#include "stm32l0xx_hal.h"
+#include "system_communication.h"
+#include "uart_logger.h"
+
+/* Defined by the widget controller on the device */
+struct driver_comm_shared_memory led_matrix_comm = {0};
+struct driver_comm_message_passing ambient_light_comm = {0};
+
+TIM_TypeDef emulator_tim21;
+
+uint32_t SystemCoreClock = 1000000000U;
+
+static uint32_t tick_ms;
+
+uint32_t HAL_GetTick(void) {
+    return tick_ms;
+}
+
+void emulator_advance_ms(uint32_t ms) {
+    tick_ms += ms;
+    emulator_tim21.CNT += ms;
+}
+
+static uint64_t emulator_nanoseconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + now.tv_nsec;
+}
+
+/* The time stamp counter where there is one, otherwise nanoseconds */
+uint64_t emulator_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return emulator_nanoseconds();
+#endif
+}
+
+void emulator_calibrate_clock(void) {
+    struct timespec wait = {.tv_nsec = 50000000};
+    uint64_t ns0 = emulator_nanoseconds();
+    uint64_t cycles0 = emulator_cycles();
+
+    nanosleep(&wait, NULL);
+
+    uint64_t cycles = emulator_cycles() - cycles0;
+    uint64_t ns = emulator_nanoseconds() - ns0;
+    uint64_t rate = cycles * 1000000000U / ns;
+
+    // The telemetry works in 32 bits, which a multi GHz counter overflows
+    SystemCoreClock = rate > UINT32_MAX ? UINT32_MAX : rate;
+}
+
+uint32_t job_queue_timestamp(void) {
+    return (uint32_t)emulator_cycles();
+}
+
+/* There is no job queue, the scenes pick their stages by the active flags */
+bool job_group_is_enabled(enum job_group group) {
+    (void)group;
+    return true;
+}
+
+/*
+ * The firmware formats uint32_t with %lu as long is 32 bits on the device.
+ * It is 64 bits on the host, so the length modifier is dropped to read the
+ * arguments as the 32 bit values they are.
+ */
+void uart_logger_send(const char *s, ...) {
+    char format[256];
+    size_t n = 0;
+    va_list args;
+
+    for (const char *c = s; *c != '\0' && n < sizeof(format) - 1; c++) {
+        if (c[0] == 'l' && c > s && c[-1] != 'l' && c[1] != 'l') {
+            const char *spec = c;
+            while (spec > s && spec[-1] != '%' &&
+                   (spec[-1] < 'a' || spec[-1] > 'z')) {
+                spec--;
+            }
+            if (spec > s && spec[-1] == '%') {
+                continue;
+            }
+        }
+        format[n++] = *c;
+    }
+    format[n] = '\0';
+
+    va_start(args, s);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+bool uart_logger_is_idle(void) {
+    return true;
+}
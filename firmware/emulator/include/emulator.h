@@ -0,0 +1,61 @@
+#ifndef __EMULATOR_H__
+#define __EMULATOR_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "charlieplex_driver.h"
+
+/*
+ * Host emulator of the led matrix pipeline.
+ *
+ * The real loader, renderer, compositor, assembler, scroll text and physics
+ * engine are built for the host and linked against the stand-ins in this
+ * directory:
+ *  * charlieplex_emulator.c replaces the charlieplex driver. Frames handed
+ * to it are unpacked from their bit-planes into a brightness per led, and
+ * a scan swaps the pending frame in the way TIM7_IRQHandler does, keeping
+ * the same frame counters.
+ *  * emulator_hal.c replaces the HAL tick, TIM21, the job queue timestamp
+ * and the uart logger. Time is simulated, so runs are repeatable and are
+ * not slowed down by the host.
+ *
+ * Job timestamps count host cycles, so the cost the emulator reports is the
+ * cost on the host. It is a relative measure to compare pipeline changes
+ * by, not a prediction of the cost on the device.
+ */
+
+/* Host cycle counter the job queue timestamp is built on */
+uint64_t emulator_cycles(void);
+
+/* Measures the host cycle counter rate and sets SystemCoreClock from it */
+void emulator_calibrate_clock(void);
+
+/* Moves simulated time on, the HAL tick and TIM21 follow it */
+void emulator_advance_ms(uint32_t ms);
+
+/* Milliseconds the driver takes to scan out one whole frame */
+uint32_t charlieplex_emulator_frame_ms(void);
+
+/*
+ * Plays out one whole scan: the pending frame is swapped in if there is
+ * one, otherwise the frame on display is shown again. Does nothing while
+ * the driver is paused.
+ */
+void charlieplex_emulator_scan(void);
+
+/*
+ * Brightness of each led on display, 0 to CHARLIEPLEX_MAX_BRIGHTNESS, in
+ * the order of the planes: led `n + 1` of 'enum leds' is at [n / 7][n % 7].
+ */
+void charlieplex_emulator_get_frame(uint8_t frame[N_DIMENSIONS][N_DIMENSIONS]);
+
+/*
+ * How long each led on display is lit for, out of 255 for an led lit the
+ * whole of its tick. It follows the bit-plane codes in charlieplex_luts.h
+ * and the duty the driver was last set to.
+ */
+void charlieplex_emulator_get_on_time(
+    uint8_t on_time[N_DIMENSIONS][N_DIMENSIONS]);
+
+#endif /* __EMULATOR_H__ */
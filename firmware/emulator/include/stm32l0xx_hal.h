@@ -0,0 +1,68 @@
+#ifndef __EMULATOR_STM32L0XX_HAL_H__
+#define __EMULATOR_STM32L0XX_HAL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Host stand-in for the parts of the STM32 HAL that the led matrix pipeline
+ * and the physics engine touch. Time comes from the emulator's simulated
+ * millisecond tick, and interrupts are never taken on the host so masking
+ * them does nothing.
+ */
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U,
+} HAL_StatusTypeDef;
+
+typedef struct {
+    volatile uint32_t CNT;
+} TIM_TypeDef;
+
+typedef struct {
+    volatile uint32_t ISR;
+} USART_TypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+} UART_HandleTypeDef;
+
+typedef struct {
+    volatile uint32_t SR;
+} RNG_TypeDef;
+
+typedef struct {
+    RNG_TypeDef *Instance;
+    uint32_t State;
+    uint32_t ErrorCode;
+} RNG_HandleTypeDef;
+
+/* TIM21 only times the physics engine, it counts simulated milliseconds */
+extern TIM_TypeDef emulator_tim21;
+#define TIM21 (&emulator_tim21)
+
+/* Core clock the emulator reports, timestamps are in host cycles */
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+
+static inline uint32_t __get_PRIMASK(void) {
+    return 0;
+}
+
+static inline void __set_PRIMASK(uint32_t primask) {
+    (void)primask;
+}
+
+static inline void __disable_irq(void) {
+}
+
+static inline void __enable_irq(void) {
+}
+
+#endif /* __EMULATOR_STM32L0XX_HAL_H__ */
@@ -0,0 +1,7 @@
+#ifndef __EMULATOR_STM32L0XX_HAL_RNG_H__
+#define __EMULATOR_STM32L0XX_HAL_RNG_H__
+
+/* The RNG handle lives with the rest of the host HAL stand-in */
+#include "stm32l0xx_hal.h"
+
+#endif /* __EMULATOR_STM32L0XX_HAL_RNG_H__ */
@@ -1,6 +1,8 @@
 #ifndef CHARLIEPLEX_DRIVER_H
 #define CHARLIEPLEX_DRIVER_H
 
+#include <stdbool.h>
+
 #include "stm32l0xx_hal.h"
 
 /*
@@ -12,9 +14,8 @@
     charlieplex_driver_draw(...);
 
     The input is an array of uint8_t's where each element corrosponds
-    to the enum value in 'enum leds'. To set an led, set the led's index
-    to itself. Ex: arr[D9] = D9;. To turn an led off, set it to 0:
-    arr[D9] = 0;
+    to the enum value in 'enum leds' and holds that led's brightness, from
+    0 (off) to CHARLIEPLEX_MAX_BRIGHTNESS. Ex: arr[D9] = 2;
 
     Turning on and off LEDs:
     An LED is turned on if and only if its two GPIO pins (control lines) are
@@ -40,6 +41,29 @@
     other LEDs that share its control lines. Each subframe is setup so the LEDs
     that share a HIGH control line are on at the same time.
 
+    Brightness is done with binary code modulation. Each brightness is mapped
+    to a CHARLIEPLEX_N_PLANES bit code, and every subframe is shown once per
+    bit-plane with the timer period scaled by the plane's weight (1, 2, 4...).
+    An led is on during the planes whose bit is set in its code, so its on
+    time is proportional to the code. The codes are generated into
+    charlieplex_luts.h by scripts/lut_generator.c along a gamma curve so the
+    levels look evenly spaced, optionally with each led calibrated to match
+    the others (see LED_GAMMA and LED_CALIBRATION in the Makefile).
+
+    Frames can also be drawn from brightness bit-planes, see struct
+    charlieplex_planes. The driver then works a whole word of leds at a time:
+    it turns the brightness planes into code planes with a few masks per
+    brightness level, and only visits the leds that are lit when building the
+    GPIO words for each subframe.
+
+    Scan-out:
+    Drawing a frame lays out every step of the scan (each subframe's
+    bit-planes followed by a blank) as a table of MODER, ODR and timer period
+    words. The timer interrupt copies one entry into the registers and moves
+    on, and the new frame is swapped in only once the last step is out. DMA
+    cannot do this instead: every DMA1 channel is already taken and a step
+    needs two GPIO registers written per timer request.
+
 
     Performance metrics:
     - Running on an STM32L072
@@ -63,6 +87,61 @@
 // Number of leds and the size of the control array
 #define NUM_LEDS (N_DIMENSIONS * N_DIMENSIONS) + 1
 
+// Brightest value an led can be drawn with
+#define CHARLIEPLEX_MAX_BRIGHTNESS 4
+
+// Rate the scan-out timer is configured for in Hz
+#define CHARLIEPLEX_REFRESH_RATE 180U
+
+/*
+ * Rate in Hz the scan-out timer actually ticks at, a subframe takes three of
+ * its ticks. The timer is set up for CHARLIEPLEX_REFRESH_RATE with a DIV4
+ * clock division, which only divides the input filter clock and not the
+ * counter, so it runs four times faster.
+ */
+#define CHARLIEPLEX_TICK_RATE (4U * CHARLIEPLEX_REFRESH_RATE)
+
+// Duty at which a subframe is lit for a whole tick
+#define CHARLIEPLEX_DUTY_FULL 255U
+
+// Number of binary code modulation bit-planes per subframe
+#define CHARLIEPLEX_N_PLANES 3
+
+// Bits needed to hold a brightness from 0 to CHARLIEPLEX_MAX_BRIGHTNESS
+#define CHARLIEPLEX_BRIGHTNESS_BITS 3
+
+// 32 bit words needed to hold one bit for every led
+#define CHARLIEPLEX_N_WORDS 2
+
+/*
+ * A frame held as brightness bit-planes. Bit `n` of `word[b]` is bit `b` of
+ * the brightness of led `n + 1` in 'enum leds', the dummy led has no bit.
+ * Word 0 holds bits 0 to 31 and word 1 the rest, unused bits must be zero.
+ */
+struct charlieplex_planes {
+    uint32_t word[CHARLIEPLEX_BRIGHTNESS_BITS][CHARLIEPLEX_N_WORDS];
+};
+
+/*
+ * Packs the brightness of every led, starting from led 1 in 'enum leds', into
+ * planes. Brightnesses above CHARLIEPLEX_MAX_BRIGHTNESS are clamped to it.
+ */
+static inline void charlieplex_planes_pack(struct charlieplex_planes *planes,
+                                           const uint8_t *leds) {
+    *planes = (struct charlieplex_planes){0};
+
+    for (uint32_t bit = 0; bit < NUM_LEDS - 1; bit++) {
+        uint32_t brightness = leds[bit] > CHARLIEPLEX_MAX_BRIGHTNESS
+                                  ? CHARLIEPLEX_MAX_BRIGHTNESS
+                                  : leds[bit];
+
+        for (int b = 0; b < CHARLIEPLEX_BRIGHTNESS_BITS; b++) {
+            planes->word[b][bit / 32U] |= ((brightness >> b) & 1U)
+                                          << (bit % 32U);
+        }
+    }
+}
+
 enum led_frame {
     LED_FRAME_1,
     LED_FRAME_2,
@@ -93,6 +172,45 @@ void charlieplex_driver_reset_pins(void);
 */
 void charlieplex_driver_draw(uint8_t *leds);
 
+/*
+    Draw a frame held as brightness bit-planes.
+*/
+void charlieplex_driver_draw_planes(const struct charlieplex_planes *planes);
+
+/*
+ * Returns true while the last frame handed to the driver is still waiting
+ * to be swapped in. Drawing another one then would drop it unseen.
+ */
+bool charlieplex_driver_is_pending(void);
+
+/*
+ * Sets the global timing of the scan-out. `refresh_rate` is the timer rate
+ * in Hz, up to CHARLIEPLEX_REFRESH_RATE, and a lower rate means fewer
+ * interrupts. `duty` is how much of its lit tick a subframe is actually
+ * lit, out of CHARLIEPLEX_DUTY_FULL, which dims every led alike and cuts
+ * the led current. The unlit part is blanked so the frame rate only
+ * depends on `refresh_rate`. Steps never get shorter than the interrupt can
+ * keep up with, which sets the dimmest duty.
+ * Returns 0 on success or -EINVAL if either is out of range.
+ */
+int charlieplex_driver_set_timing(uint32_t refresh_rate, uint32_t duty);
+
+/*
+ * Frame counters kept by the driver:
+ *  * `n_draws` frames were handed to the driver.
+ *  * `n_shown` of them were swapped in and reached the leds.
+ *  * `n_repeats` scans reshowed the previous frame as nothing new was ready.
+ *  * `n_dropped` frames were replaced by a newer one before being shown.
+ */
+struct charlieplex_driver_stats {
+    uint32_t n_draws;
+    uint32_t n_shown;
+    uint32_t n_repeats;
+    uint32_t n_dropped;
+};
+
+void charlieplex_driver_get_stats(struct charlieplex_driver_stats *stats);
+
 void pause_charlieplex_driver(void);
 
 void unpause_charlieplex_driver(void);
@@ -47,6 +47,9 @@ struct i2c_request {
     uint8_t *buffer;
     // Number of bytes to read/write
     size_t num_bytes;
+    // Job events for the request's owner, posted along with the bus's own
+    // JOB_EVENT_I2C_DONE when the transfer completes. 0 for none
+    uint32_t done_events;
 
     struct future future;
 };
@@ -12,7 +12,10 @@ void music_player_run(void);
 enum music_player_error music_player_play_song(
     struct music_player *music_player, enum Song song);
 
-/* Stop the current song - returns MUSIC_PLAYER_STOP_ERROR on failure */
+/*
+ * Stop the current song - returns MUSIC_PLAYER_STOP_ERROR on failure. The
+ * song is stopped before returning.
+ */
 enum music_player_error music_player_abort_song(
     struct music_player *music_player);
 
@@ -23,6 +23,12 @@ int uart_logger_send_bytes(const char *bytes, size_t len);
 
 void uart_logger_run(void);
 
+/* Returns true if there is data to send and the uart is free */
+bool uart_logger_is_pending(void);
+
+/* Returns true if everything sent so far has been transmitted */
+bool uart_logger_is_idle(void);
+
 extern UART_HandleTypeDef uart;
 
 extern volatile bool uart_busy;
@@ -0,0 +1,82 @@
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+
+#include <stddef.h>
+
+#include "futures.h"
+
+/*
+ * Stackless coroutines for jobs, in the style of protothreads.
+ *
+ * A coroutine is an ordinary function returning `enum coroutine_status` that
+ * takes a `struct coroutine` holding its resume point. The body is written as
+ * a straight line of steps between `COROUTINE_BEGIN` and `COROUTINE_END`.
+ * When a wait condition is not met the function returns `COROUTINE_WAITING`
+ * and the next call jumps straight back to the wait, so a job can do
+ * "enqueue, await future, process" without a state per i2c round trip. If
+ * the condition already holds the coroutine carries on in the same call.
+ *
+ * The resume point is stored with GCC's labels as values, so the body may
+ * freely contain switch statements. Local variables are NOT preserved across
+ * a wait, keep anything that must survive in static or context storage.
+ */
+enum coroutine_status {
+    COROUTINE_WAITING = 0,
+    COROUTINE_DONE,
+};
+
+struct coroutine {
+    void *resume_point;  // NULL when the coroutine is at its start
+};
+
+#define COROUTINE_INIT {.resume_point = NULL}
+
+#define COROUTINE_RESET(co) ((co)->resume_point = NULL)
+
+#define COROUTINE_IS_RUNNING(co) ((co)->resume_point != NULL)
+
+#define __COROUTINE_CONCAT(a, b) a##b
+#define _COROUTINE_CONCAT(a, b) __COROUTINE_CONCAT(a, b)
+#define _COROUTINE_LABEL _COROUTINE_CONCAT(coroutine_resume_, __LINE__)
+
+/* Must be the first statement of the coroutine body */
+#define COROUTINE_BEGIN(co)               \
+    do {                                  \
+        if ((co)->resume_point != NULL) { \
+            goto *(co)->resume_point;     \
+        }                                 \
+    } while (0)
+
+/* Returns `COROUTINE_WAITING` until `cond` is true */
+#define COROUTINE_WAIT_UNTIL(co, cond)            \
+    do {                                          \
+        (co)->resume_point = &&_COROUTINE_LABEL;  \
+        _COROUTINE_LABEL:                         \
+        if (!(cond)) {                            \
+            return COROUTINE_WAITING;             \
+        }                                         \
+    } while (0)
+
+/* Waits for the future to finish or error out */
+#define COROUTINE_AWAIT_FUTURE(co, future) \
+    COROUTINE_WAIT_UNTIL(co, future_get_state(future) != FUTURE_WAITING)
+
+/* Gives up the rest of this call unconditionally */
+#define COROUTINE_YIELD(co)                      \
+    do {                                         \
+        (co)->resume_point = &&_COROUTINE_LABEL; \
+        return COROUTINE_WAITING;                \
+        _COROUTINE_LABEL:;                       \
+    } while (0)
+
+/* Finishes early, the next call starts again from the beginning */
+#define COROUTINE_EXIT(co)         \
+    do {                           \
+        COROUTINE_RESET(co);       \
+        return COROUTINE_DONE;     \
+    } while (0)
+
+/* Must be the last statement of the coroutine body */
+#define COROUTINE_END(co) COROUTINE_EXIT(co)
+
+#endif /* __COROUTINE_H__ */
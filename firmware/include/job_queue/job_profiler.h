@@ -0,0 +1,82 @@
+#ifndef __JOB_PROFILER_H__
+#define __JOB_PROFILER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "job_queue.h"
+
+/*
+ * The job profiler records, for every job the job queue dispatches, how many
+ * times it ran and the total, minimum and maximum time it took along with a
+ * coarse histogram. Times are measured in core clock cycles.
+ *
+ * Profiles are keyed by the job function so a job added to several queues
+ * shares one entry. A name can be registered for each job to make the dump
+ * readable, unnamed jobs are printed by address.
+ *
+ * Recording is a handful of adds and compares per dispatch so it is left on
+ * by default. Setting JOB_PROFILER_ENABLED to 0 compiles it out entirely.
+ */
+#define JOB_PROFILER_ENABLED 1
+
+/*
+ * Dump the table on this period over the uart logger, 0 to only dump when
+ * job_profiler_dump() is called. The widget controller calls it on a double
+ * tap along the z axis.
+ */
+#define JOB_PROFILER_DUMP_PERIOD_MS 0U
+
+/*
+ * Histogram bucket `i` counts runs shorter than
+ * JOB_PROFILER_FIRST_BUCKET_CYCLES << i, the last bucket counts the rest.
+ */
+#define JOB_PROFILER_N_BUCKETS 8
+#define JOB_PROFILER_FIRST_BUCKET_CYCLES 128U
+
+struct job_profile {
+    job_fn_t fn;
+    const char *name;
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint32_t histogram[JOB_PROFILER_N_BUCKETS];
+};
+
+#if JOB_PROFILER_ENABLED
+
+/*
+ * Returns the profile for `fn`, creating it if needed.
+ * Returns NULL if the profile table is full.
+ */
+struct job_profile *job_profiler_get(job_fn_t fn);
+
+/* Tag the job with a name that is used when dumping the table */
+int job_profiler_register(job_fn_t fn, const char *name);
+
+/* Add a single run of `cycles` to the profile. `profile` may be NULL */
+void job_profiler_record(struct job_profile *profile, uint32_t cycles);
+
+/* Clears the recorded statistics but keeps the names */
+void job_profiler_reset(void);
+
+/*
+ * Requests a dump of the table over the uart. The uart buffer is too small
+ * for the whole table so `job_profiler_run` prints it a line at a time.
+ */
+void job_profiler_dump(void);
+
+bool job_profiler_is_ready(void);
+
+void job_profiler_run(void);
+
+#else
+
+#define job_profiler_register(fn, name) ((void)0)
+#define job_profiler_reset() ((void)0)
+#define job_profiler_dump() ((void)0)
+
+#endif /* JOB_PROFILER_ENABLED */
+
+#endif /* __JOB_PROFILER_H__ */
@@ -2,6 +2,8 @@
 #define __JOB_QUEUE_H__
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
  * A job is a function called, without argument, during
@@ -11,19 +13,50 @@
  *  * `JOB_RUN_ENTRY` jobs are run exactly once when
  * we enter the run state.
  *  * `JOB_RUN_RUN` jobs are run
- * consecutively for as long as we are in the run state.
+ * repeatedly for as long as we are in the run state.
  *  * `JOB_ERROR_ENTRY` jobs are run exactly once as we enter the
  * error state.
- *  * `JOB_ERROR_RUN` jobs are run consecutively for
+ *  * `JOB_ERROR_RUN` jobs are run repeatedly for
  * as long as we are in the error state.
  *
  * Jobs may be added to the job queue with `job_add`. It is recommended
  * that _all_ such jobs are added before beginning to call
- * `job_state_machine_run`. Jobs are run in the order in which `job_add` is
- * called.
+ * `job_state_machine_run`. Init and entry jobs are run in the order in which
+ * `job_add` is called.
+ *
+ * Run jobs are scheduled rather than run round robin. Each call to
+ * `job_state_machine_run` dispatches the single most urgent job that is due:
+ * a job is due when its period has elapsed since it last ran and its ready
+ * predicate (if any) returns true. The most urgent job is the one with the
+ * highest priority, ties being broken by whichever has been due the longest.
+ * Priorities are strict, so a high priority job must be gated by a period or
+ * ready predicate or it will starve everything below it.
+ *
+ * A job may instead subscribe to a mask of event flags, in which case it is
+ * only due once one of its events has been posted with `job_event_post`,
+ * typically from an interrupt. Its period, if non zero, then acts as a
+ * timeout so the job still runs if no event arrives. Posted events are
+ * cleared just before the job is dispatched, so a job that needs to run
+ * again without outside help must post its own event.
+ *
+ * A run job may also be given a time budget. Every dispatch that takes longer
+ * is counted as an overrun against the job, and the longest overrun seen is
+ * kept along with the job that caused it. If the job also has an overrun
+ * limit then that many overruns in a row are treated as an unrecoverable
+ * error and the queue enters the error state with -ETIMEDOUT.
+ *
+ * Run jobs can be put in a job group. Disabling a group takes its jobs out
+ * of the scheduler entirely until the group is enabled again, so they cost
+ * nothing while disabled. Groups have no effect on init and entry jobs.
+ *
+ * If no job is due the core sleeps with WFI until the next interrupt. SysTick
+ * fires every millisecond so periodic jobs are never late by more than that.
  */
 typedef void (*job_fn_t)(void);
 
+/* Returns true if the job has work to do */
+typedef bool (*job_ready_fn_t)(void);
+
 enum job_type {
     JOB_INIT = 0,
     JOB_RUN_ENTRY,
@@ -33,8 +66,68 @@ enum job_type {
     N_JOB_TYPES,
 };
 
+enum job_priority {
+    JOB_PRIORITY_HIGH = 0,
+    JOB_PRIORITY_NORMAL,
+    JOB_PRIORITY_LOW,
+    N_JOB_PRIORITIES,
+};
+
+/*
+ * Event flags posted by interrupts and jobs. Each is a single bit so a job
+ * can subscribe to several.
+ */
+enum job_event {
+    JOB_EVENT_ACCELERATION_IT = (1U << 0),    // LSM6DSM int1 or int2 fired
+    JOB_EVENT_AMBIENT_LIGHT_IT = (1U << 1),   // VCNL4020 interrupt fired
+    JOB_EVENT_I2C_QUEUED = (1U << 2),         // A request was queued on i2c1
+    JOB_EVENT_I2C_DONE = (1U << 3),           // An i2c1 transfer completed
+    JOB_EVENT_SENSOR_REQUEST = (1U << 4),     // A sensor request was made
+    JOB_EVENT_UART = (1U << 5),               // Logger has data or finished
+    JOB_EVENT_MUSIC_PLAYER = (1U << 6),       // Song requested or finished
+    JOB_EVENT_I2C_ACCELERATION = (1U << 7),   // An LSM6DSM transfer completed
+    JOB_EVENT_I2C_AMBIENT_LIGHT = (1U << 8),  // A VCNL4020 transfer completed
+};
+
+/*
+ * Job groups, each a single bit so several can be switched at once. A job
+ * may belong to several groups and only runs while all of them are enabled.
+ */
+enum job_group {
+    JOB_GROUP_NONE = 0,                  // Never disabled
+    JOB_GROUP_DISPLAY = (1U << 0),       // Led matrix frame pipeline
+    JOB_GROUP_GAME = (1U << 1),          // Game engine updates
+    JOB_GROUP_AUDIO = (1U << 2),         // Music player
+    JOB_GROUP_LED_LOADER = (1U << 3),    // Led matrix animation layer
+    JOB_GROUP_LED_RENDERER = (1U << 4),  // Led matrix sprite layer
+};
+
+struct job_schedule {
+    enum job_priority priority;
+    uint32_t period_ms;      // Minimum time between runs, 0 to run when ready
+    job_ready_fn_t ready;    // NULL if the job is always ready
+    uint32_t events;         // Mask of `enum job_event`, 0 to not subscribe
+    uint32_t budget_us;      // Longest a single run may take, 0 for no limit
+    uint32_t overrun_limit;  // Consecutive overruns before error, 0 to never
+    uint32_t group;          // Mask of `enum job_group` the job belongs to
+};
+
+/* Adds a normal priority job that is always ready */
 int job_add(job_fn_t fn, enum job_type type);
 
+/*
+ * Adds a job with the given schedule. The schedule only affects run jobs,
+ * init and entry jobs are run once each regardless.
+ */
+int job_add_scheduled(job_fn_t fn, enum job_type type,
+                      const struct job_schedule *schedule);
+
+/* Enables or disables every job in the given mask of `enum job_group` */
+void job_group_enable(uint32_t groups);
+void job_group_disable(uint32_t groups);
+
+bool job_group_is_enabled(enum job_group group);
+
 /*
  * `job_state_machine_run` should be called for as long as the main loop runs.
  */
@@ -46,4 +139,53 @@ void job_state_machine_run(void);
  */
 void job_error_state_enter(int error);
 
+/*
+ * Marks `events` as pending for every run job subscribed to any of them.
+ * Safe to call from interrupts.
+ */
+void job_event_post(uint32_t events);
+
+/*
+ * Timestamp in core clock cycles built from the HAL tick and the SysTick
+ * down counter, so that jobs shorter than a millisecond are still resolved.
+ * Only differences between timestamps are meaningful.
+ */
+uint32_t job_queue_timestamp(void);
+
+/*
+ * Time spent in the main loop, in core clock cycles, split between running
+ * jobs and sleeping because no job was due.
+ */
+struct job_queue_stats {
+    uint64_t busy_cycles;
+    uint64_t idle_cycles;
+    uint32_t n_dispatches;
+    uint32_t n_idles;
+    uint32_t n_overruns;
+    job_fn_t worst_overrun_fn;  // NULL if no job has overrun its budget
+    uint32_t worst_overrun_cycles;
+};
+
+/* Overrun counters for a single job with a budget */
+struct job_overrun {
+    job_fn_t fn;
+    uint32_t budget_cycles;
+    uint32_t n_overruns;
+    uint32_t n_consecutive;
+    uint32_t worst_cycles;
+};
+
+void job_queue_get_stats(struct job_queue_stats *stats);
+
+void job_queue_reset_stats(void);
+
+/*
+ * Copies the overrun counters of up to `len` budgeted run jobs into
+ * `overruns` and returns how many were copied.
+ */
+size_t job_queue_get_overruns(struct job_overrun *overruns, size_t len);
+
+/* Prints the busy/idle split and the worst overrun over the uart */
+void job_queue_log_stats(void);
+
 #endif /* __JOB_QUEUE_H__ */
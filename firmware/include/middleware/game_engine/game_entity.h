@@ -16,6 +16,16 @@ struct game_entity {
 bool game_entity_init(struct game_entity *game_entity, struct entity *entity,
                       const struct sprite *sprite);
 
+/* Moves the sprite to where the entity is drawn, to a fraction of an led */
+void game_entity_sync_sprite(struct game_entity *game_entity);
+
+/*
+ * Syncs the sprites of the active entities of env, whose game entities are
+ * held in game_entities by entity index
+ */
+void game_entities_sync_sprites(struct game_entity *game_entities,
+                                const struct physics_engine_environment *env);
+
 void set_game_entity_position(struct game_entity *game_entity,
                               position new_position);
 void set_game_entity_position_relative(struct game_entity *game_entity,
@@ -57,6 +57,9 @@
 /* Is the ball solid */
 #define BRICK_BREAKER_BALL_SOLID true
 
+/* Does the ball collide along its path, so it cannot pass a brick */
+#define BRICK_BREAKER_BALL_SWEPT true
+
 /* Ball sprite */
 #define BRICK_BREAKER_BALL_SPRITE (&small_ball)
 
@@ -153,15 +156,20 @@ struct brick_breaker_game_config {
     const struct entity_init_struct *const brick_init_struct;
 };
 
+/* Number of entities in the game environment */
+#define BRICK_BREAKER_NUM_OF_ENTITIES (BRICK_BREAKER_NUM_OF_BRICKS + 2)
+
 struct brick_breaker_game_context {
     struct game_common game_common;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(BRICK_BREAKER_NUM_OF_ENTITIES)
+        environment_storage;
     union {
         struct {
             struct game_entity user_paddle;
             struct game_entity ball;
             struct game_entity bricks[BRICK_BREAKER_NUM_OF_BRICKS];
         };
-        struct game_entity game_entities[(BRICK_BREAKER_NUM_OF_BRICKS + 2)];
+        struct game_entity game_entities[BRICK_BREAKER_NUM_OF_ENTITIES];
     };
     uint8_t lives;
     uint8_t bricks_remaining;
@@ -191,6 +199,7 @@ static const struct entity_init_struct brick_breaker_ball_init_struct = {
     .velocity = BRICK_BREAKER_BALL_START_VELOCITY,
     .acceleration = BRICK_BREAKER_BALL_START_ACCELERATION,
     .solid = BRICK_BREAKER_BALL_SOLID,
+    .swept = BRICK_BREAKER_BALL_SWEPT,
 };
 
 static const struct entity_init_struct brick_breaker_brick_init_struct = {
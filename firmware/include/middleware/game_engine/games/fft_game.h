@@ -60,13 +60,18 @@ struct fft_game_config {
     const struct entity_init_struct *const histogram_bar_init_struct;
 };
 
+/* Number of entities in the game environment */
+#define FFT_GAME_NUM_OF_ENTITIES FFT_GAME_NUM_OF_HISTOGRAM_BARS
+
 struct fft_game_context {
     struct game_common game_common;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(FFT_GAME_NUM_OF_ENTITIES)
+        environment_storage;
     union {
         struct {
             struct game_entity histogram_bars[FFT_GAME_NUM_OF_HISTOGRAM_BARS];
         };
-        struct game_entity game_entities[FFT_GAME_NUM_OF_HISTOGRAM_BARS];
+        struct game_entity game_entities[FFT_GAME_NUM_OF_ENTITIES];
     };
 };
 
@@ -17,6 +17,11 @@ struct game_common {
     enum game_state game_state;
 };
 
+/*
+ * Initializes the event queue and game state. Each game sizes the entity
+ * storage of its environment, so the environment is initialized by the game
+ * with PHYSICS_ENGINE_ENVIRONMENT_INIT.
+ */
 void game_common_init(struct game_common *game_common);
 
 #endif /*__GAME_COMMON_H__*/
\ No newline at end of file
@@ -83,6 +83,9 @@
 /* Is the ball solid */
 #define PONG_BALL_SOLID true
 
+/* Does the ball collide along its path, so it cannot pass a paddle */
+#define PONG_BALL_SWEPT true
+
 /* Ball sprite */
 #define PONG_BALL_SPRITE (&small_ball)
 
@@ -104,16 +107,21 @@ struct pong_game_config {
     const struct entity_init_struct *const ball_init_struct;
 };
 
+/* Number of entities in the game environment */
+#define PONG_GAME_NUM_OF_ENTITIES 3
+
 /* Pong game context struct */
 struct pong_game_context {
     struct game_common game_common;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(PONG_GAME_NUM_OF_ENTITIES)
+        environment_storage;
     union {
         struct {
             struct game_entity user_paddle;
             struct game_entity opponent_paddle;
             struct game_entity ball;
         };
-        struct game_entity game_entities[3];
+        struct game_entity game_entities[PONG_GAME_NUM_OF_ENTITIES];
     };
     uint8_t user_score;
     uint8_t opponent_score;
@@ -152,6 +160,7 @@ static const struct entity_init_struct pong_ball_init_struct = {
     .velocity = PONG_BALL_START_VELOCITY,
     .acceleration = PONG_BALL_START_ACCELERATION,
     .solid = PONG_OPPONENT_PADDLE_SOLID,
+    .swept = PONG_BALL_SWEPT,
 };
 
 #define CREATE_PONG_GAME()                                                \
@@ -38,15 +38,21 @@ struct snowfall_game_config {
     const struct entity_init_struct *const snowflake_init_struct;
 } __attribute__((aligned(4)));
 
+/* Number of entities in the game environment */
+#define SNOWFALL_NUM_OF_ENTITIES SNOWFALL_MAX_SNOWFLAKES
+
 struct snowfall_game_context {
     struct game_common game_common;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(SNOWFALL_NUM_OF_ENTITIES)
+        environment_storage;
     union {
         struct {
             struct game_entity snowflakes[SNOWFALL_MAX_SNOWFLAKES];
         };
-        struct game_entity game_entities[SNOWFALL_MAX_SNOWFLAKES];
+        struct game_entity game_entities[SNOWFALL_NUM_OF_ENTITIES];
     };
     uint8_t num_snowflakes;
+    uint8_t snowflake_pool;
 };
 
 struct snowfall_game {
@@ -164,8 +164,15 @@ struct space_invaders_game_config {
     const struct entity_init_struct *const enemy_bullet_init_struct;
 };
 
+/* Number of entities in the game environment */
+#define SPACE_INVADERS_NUM_OF_ENTITIES                                     \
+    (SPACE_INVADERS_NUM_OF_ENEMY_SHIPS + SPACE_INVADERS_MAX_USER_BULLETS + \
+     SPACE_INVADERS_MAX_ENEMY_BULLETS + 1)
+
 struct space_invaders_game_context {
     struct game_common game_common;
+    PHYSICS_ENGINE_ENVIRONMENT_STORAGE(SPACE_INVADERS_NUM_OF_ENTITIES)
+        environment_storage;
     union {
         struct {
             struct game_entity user_ship;
@@ -173,9 +180,7 @@ struct space_invaders_game_context {
             struct game_entity user_bullets[SPACE_INVADERS_MAX_USER_BULLETS];
             struct game_entity enemy_bullets[SPACE_INVADERS_MAX_ENEMY_BULLETS];
         };
-        struct game_entity game_entities[SPACE_INVADERS_NUM_OF_ENEMY_SHIPS +
-                                         SPACE_INVADERS_MAX_USER_BULLETS +
-                                         SPACE_INVADERS_MAX_ENEMY_BULLETS + 1];
+        struct game_entity game_entities[SPACE_INVADERS_NUM_OF_ENTITIES];
     } __attribute__((aligned(4)));
     volatile uint32_t num_of_user_bullets __attribute__((aligned(4)));
     volatile uint32_t num_of_enemy_bullets __attribute__((aligned(4)));
@@ -183,6 +188,8 @@ struct space_invaders_game_context {
     volatile uint32_t last_user_bullet_time;
     volatile uint8_t enemies_remaining;
     volatile uint8_t lives;
+    uint8_t user_bullet_pool;
+    uint8_t enemy_bullet_pool;
 } __attribute__((aligned(4)));
 
 struct space_invaders_game {
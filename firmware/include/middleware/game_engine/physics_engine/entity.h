@@ -20,16 +20,24 @@ struct entity_init_struct {
     acceleration acceleration;
     enum mass mass;
     bool solid;
+    /*
+     * Collide along the path moved in an update instead of where the update
+     * leaves it, so a fast entity cannot pass through a thin one. It only
+     * applies to solid entities and costs a test against every other solid
+     * entity each update.
+     */
+    bool swept;
 } __attribute__((aligned(4)));
 
-/* Entity structure */
+struct physics_engine_environment;
+
+/*
+ * Entity handle. The state of the entity is kept in the arrays of its
+ * environment at entity_idx, and is reached through the getters and setters
+ * below.
+ */
 struct entity {
-    struct rectangle rectangle;
-    velocity velocity;
-    acceleration acceleration;
-    enum mass mass;
-    bool solid;
-    volatile bool active;
+    struct physics_engine_environment *environment;
     uint8_t entity_idx;
 } __attribute__((aligned(4)));
 
@@ -55,10 +63,14 @@ void set_entity_acceleration_relative(struct entity *ent,
 
 /* Getters */
 position get_entity_position(struct entity *ent);
+/* Where to draw the entity, between its last two updates */
+position get_entity_render_position(struct entity *ent);
+struct rectangle get_entity_rectangle(struct entity *ent);
 velocity get_entity_velocity(struct entity *ent);
 acceleration get_entity_acceleration(struct entity *ent);
 
 void activate_entity(struct entity *ent);
 void deactivate_entity(struct entity *ent);
+bool entity_is_active(struct entity *ent);
 
 #endif
@@ -13,8 +13,8 @@
 
 /* A 2-Dimensional Vector */
 struct vec2 {
-    volatile int32_t x;
-    volatile int32_t y;
+    int32_t x;
+    int32_t y;
 };
 
 typedef struct vec2 position;
@@ -46,6 +46,13 @@ enum mass {
 #define GET_POSITION_GRID_Y(pos) \
     (uint8_t)((pos.y - GRID_MIN + (GRID_UNIT_SIZE / 2)) / GRID_UNIT_SIZE)
 
+/* Position in 1 / (1 << `bits`) of a grid unit, rounded down */
+#define GET_POSITION_SUBGRID_X(pos, bits) \
+    (int32_t)(((pos.x - GRID_MIN) << (bits)) / GRID_UNIT_SIZE)
+
+#define GET_POSITION_SUBGRID_Y(pos, bits) \
+    (int32_t)(((pos.y - GRID_MIN) << (bits)) / GRID_UNIT_SIZE)
+
 /* Rectangle entity type implementation */
 struct rectangle {
     position p1, p2;
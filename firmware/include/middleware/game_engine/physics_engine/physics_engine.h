@@ -25,8 +25,17 @@ struct physics_engine {
 } __attribute__((aligned(4)));
 
 void physics_engine_init(struct physics_engine *physics_engine);
-void physics_engine_update(struct physics_engine *physics_engine,
-                           uint32_t delta_t);
+
+/*
+ * Counts the delta_us that went by towards the environment's fixed steps and
+ * returns how many are due. Run each with physics_engine_step(), handling
+ * the events it queues before running the next.
+ */
+uint32_t physics_engine_update(struct physics_engine *physics_engine,
+                               uint32_t delta_us);
+
+/* Runs one fixed step of the environment */
+void physics_engine_step(struct physics_engine *physics_engine);
 
 void physics_engine_set_context(struct physics_engine *physics_engine,
                                 struct physics_engine_environment *environment,
@@ -1,13 +1,12 @@
 #ifndef __PHYSICS_ENGINE_ENVIRONMENT_H__
 #define __PHYSICS_ENGINE_ENVIRONMENT_H__
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "entity.h"
 #include "environment.h"
 #include "physics_engine_events.h"
 
-#define MAX_ENTITIES 32
-
 /* Enumeration of entity creation errors */
 enum entity_creation_error;
 
@@ -34,23 +33,246 @@ struct entity_creation_result {
     struct entity *entity;
 } __attribute__((aligned(4)));
 
-/* Environment structure */
+/* Words in a bitmask with a bit for each of `__n__` entities */
+#define PHYSICS_ENGINE_MASK_WORDS(__n__) (((__n__) + 31U) / 32U)
+
+/*
+ * Storage for an environment of up to `__n__` entities, at most UINT8_MAX
+ * as the index arrays and the pools hold entity indices in a byte. Each
+ * environment sizes it to the entities it holds and hands it to
+ * PHYSICS_ENGINE_ENVIRONMENT_INIT.
+ *
+ * The state of the entities is kept as an array per field, so the update
+ * runs over plain arrays of the fields it needs. The entities array only
+ * holds the handles given out by add_entity().
+ *  * live holds the indices of the active entities, and live_slot where
+ * each active entity is in it. The broadphase keeps it sorted by left edge
+ * from update to update.
+ *  * pool_order and pool_slot do the same for the entities of each pool,
+ * see physics_engine_environment_add_pool().
+ *  * contacts holds, for each entity set in colliding, the lowest index
+ * entity after it that it overlaps.
+ *  * prev_x1 and prev_y1 hold the top left corners from before the last
+ * update, which the entities are drawn between.
+ *  * hit marks the swept entities that collided in the swept check of this
+ * update, which the discrete check then leaves be.
+ */
+#define PHYSICS_ENGINE_ENVIRONMENT_STORAGE(__n__)             \
+    struct {                                                  \
+        _Static_assert((__n__) <= UINT8_MAX,                  \
+                       "Entity indices are kept in a byte");  \
+        struct entity entities[(__n__)];                      \
+        int32_t x1[(__n__)];                                  \
+        int32_t y1[(__n__)];                                  \
+        int32_t x2[(__n__)];                                  \
+        int32_t y2[(__n__)];                                  \
+        int32_t prev_x1[(__n__)];                             \
+        int32_t prev_y1[(__n__)];                             \
+        int32_t vx[(__n__)];                                  \
+        int32_t vy[(__n__)];                                  \
+        int32_t ax[(__n__)];                                  \
+        int32_t ay[(__n__)];                                  \
+        uint32_t active[PHYSICS_ENGINE_MASK_WORDS(__n__)];    \
+        uint32_t solid[PHYSICS_ENGINE_MASK_WORDS(__n__)];     \
+        uint32_t swept[PHYSICS_ENGINE_MASK_WORDS(__n__)];     \
+        uint32_t hit[PHYSICS_ENGINE_MASK_WORDS(__n__)];       \
+        uint32_t colliding[PHYSICS_ENGINE_MASK_WORDS(__n__)]; \
+        uint8_t mass[(__n__)];                                \
+        uint8_t live[(__n__)];                                \
+        uint8_t live_slot[(__n__)];                           \
+        uint8_t pool_order[(__n__)];                          \
+        uint8_t pool_slot[(__n__)];                           \
+        uint8_t contacts[(__n__)];                            \
+    } __attribute__((aligned(4)))
+
+/* Number of entities the given environment storage holds */
+#define PHYSICS_ENGINE_ENVIRONMENT_CAPACITY(__storage__) \
+    (sizeof((__storage__)->entities) / sizeof((__storage__)->entities[0]))
+
+/* Most pools an environment keeps free lists for */
+#define PHYSICS_ENGINE_MAX_POOLS 4
+
+/*
+ * A run of n entities of one kind starting at entity first. Its part of
+ * pool_order holds the active entities of the pool first, so the entity
+ * after them is the next free one.
+ */
+struct physics_engine_pool {
+    uint8_t first;
+    uint8_t n;
+    uint8_t n_active;
+} __attribute__((aligned(4)));
+
+/* Fractional bits of the times of impact of the swept check, in ms */
+#define PHYSICS_ENGINE_TOI_BITS 8
+
+/* Length of a physics step, in ms */
+#define PHYSICS_ENGINE_TICK_MS 4
+
+/*
+ * Most steps physics_engine_environment_accumulate() returns at once, as
+ * long as the longest frame TIM21 measures. Time past it is dropped, so one
+ * long frame cannot leave the steps after it behind too.
+ */
+#define PHYSICS_ENGINE_MAX_STEPS 8
+
+/* Fractional bits of interpolation_lag */
+#define PHYSICS_ENGINE_INTERPOLATION_BITS 8
+
+/* Environment structure, its arrays point into the environment storage */
 struct physics_engine_environment {
-    struct entity entities[MAX_ENTITIES];
+    struct entity *entities;
+
+    /* Rectangle corners, (x1, y1) top left and (x2, y2) bottom right */
+    int32_t *x1;
+    int32_t *y1;
+    int32_t *x2;
+    int32_t *y2;
+    int32_t *prev_x1;
+    int32_t *prev_y1;
+
+    int32_t *vx;
+    int32_t *vy;
+    int32_t *ax;
+    int32_t *ay;
+
+    /* Bitmasks, bit `n % 32` of word `n / 32` is entity n's flag */
+    uint32_t *active;
+    uint32_t *solid;
+    uint32_t *swept;
+    uint32_t *hit;  // Resolved by the swept check this update
+    uint32_t *colliding;
+
+    uint8_t *mass;  // enum mass
+    uint8_t *live;
+    uint8_t *live_slot;
+    uint8_t *pool_order;
+    uint8_t *pool_slot;
+    uint8_t *contacts;
+
+    uint32_t max_entities;
     uint32_t num_of_entities;
+    uint32_t num_live;
+    uint32_t num_swept;  // Swept and solid, the swept check skips if none
+    uint32_t num_hits;   // Set in hit this update
+
+    /* Fixed step physics_engine_environment_accumulate() counts in */
+    uint32_t tick_ms;
+    uint32_t max_steps;
+    uint32_t accumulator_us;  // Time carried over to the next step
+
+    /*
+     * How far behind the last update the entities are drawn, as a fraction
+     * of an update in PHYSICS_ENGINE_INTERPOLATION_BITS bits. 0 draws them
+     * where the last update left them.
+     */
+    uint32_t interpolation_lag;
+
+    struct physics_engine_pool pools[PHYSICS_ENGINE_MAX_POOLS];
+    uint32_t num_pools;
+
+    /* Rectangle overlap tests run by the collision check, for profiling */
+    uint32_t n_pair_tests;
     bool paused;
 } __attribute__((aligned(4)));
 
+/*
+ * Initializes an empty environment on top of storage declared with
+ * PHYSICS_ENGINE_ENVIRONMENT_STORAGE
+ */
+#define PHYSICS_ENGINE_ENVIRONMENT_INIT(__env__, __storage__)              \
+    (*(__env__) = (struct physics_engine_environment){                     \
+         .entities = (__storage__)->entities,                              \
+         .x1 = (__storage__)->x1,                                          \
+         .y1 = (__storage__)->y1,                                          \
+         .x2 = (__storage__)->x2,                                          \
+         .y2 = (__storage__)->y2,                                          \
+         .prev_x1 = (__storage__)->prev_x1,                                \
+         .prev_y1 = (__storage__)->prev_y1,                                \
+         .vx = (__storage__)->vx,                                          \
+         .vy = (__storage__)->vy,                                          \
+         .ax = (__storage__)->ax,                                          \
+         .ay = (__storage__)->ay,                                          \
+         .active = (__storage__)->active,                                  \
+         .solid = (__storage__)->solid,                                    \
+         .swept = (__storage__)->swept,                                    \
+         .hit = (__storage__)->hit,                                        \
+         .colliding = (__storage__)->colliding,                            \
+         .mass = (__storage__)->mass,                                      \
+         .live = (__storage__)->live,                                      \
+         .live_slot = (__storage__)->live_slot,                            \
+         .pool_order = (__storage__)->pool_order,                          \
+         .pool_slot = (__storage__)->pool_slot,                            \
+         .contacts = (__storage__)->contacts,                              \
+         .max_entities = PHYSICS_ENGINE_ENVIRONMENT_CAPACITY(__storage__), \
+         .tick_ms = PHYSICS_ENGINE_TICK_MS,                                \
+         .max_steps = PHYSICS_ENGINE_MAX_STEPS,                            \
+     })
+
+static inline bool physics_engine_mask_get(const uint32_t *mask,
+                                           uint32_t idx) {
+    return (mask[idx / 32U] >> (idx % 32U)) & 1U;
+}
+
+static inline void physics_engine_mask_set(uint32_t *mask, uint32_t idx,
+                                           bool value) {
+    if (value) {
+        mask[idx / 32U] |= 1U << (idx % 32U);
+    } else {
+        mask[idx / 32U] &= ~(1U << (idx % 32U));
+    }
+}
+
 /* Add an entity to the given environment based on the provided init struct */
 struct entity_creation_result add_entity(
     struct physics_engine_environment *env,
     struct entity_init_struct *init_struct);
 
+/*
+ * Makes the entities first to first + n - 1 a pool, so a free one can be
+ * found with physics_engine_environment_get_free_entity() without a scan.
+ * The entities must already be added and must not be in another pool.
+ * Returns the pool, or -EINVAL or -ENOSPC.
+ */
+int physics_engine_environment_add_pool(struct physics_engine_environment *env,
+                                        uint32_t first, uint32_t n);
+
+/* An inactive entity of the given pool, or NULL if they are all active */
+struct entity *physics_engine_environment_get_free_entity(
+    struct physics_engine_environment *env, uint32_t pool);
+
+/* Add the entity at idx to the live list and take it off its free list */
+void physics_engine_environment_activate(
+    struct physics_engine_environment *env, uint32_t idx);
+
+/* Take the entity at idx off the live list and put it on its free list */
+void physics_engine_environment_deactivate(
+    struct physics_engine_environment *env, uint32_t idx);
+
 /* Updates the provided physics engine environment */
 void physics_engine_environment_update(struct ring_buffer *event_queue,
                                        struct physics_engine_environment *env,
                                        uint32_t delta_t);
 
+/*
+ * Adds delta_us of time and returns how many fixed steps of tick_ms are due,
+ * carrying what is left of a step over to the next call. The caller runs
+ * each with physics_engine_environment_update() so it can handle one step's
+ * events before the next. Sets interpolation_lag to draw the entities that
+ * far between their last two steps, so they move smoothly whatever the
+ * frame rate.
+ */
+uint32_t physics_engine_environment_accumulate(
+    struct physics_engine_environment *env, uint32_t delta_us);
+
+/*
+ * Sets the step physics_engine_environment_accumulate() counts in. A longer one
+ * costs less but moves entities further per step, leaving fast ones more
+ * to the swept check. Returns -EINVAL if tick_ms is 0.
+ */
+int physics_engine_environment_set_tick(struct physics_engine_environment *env,
+                                        uint32_t tick_ms);
+
 /* Prints the provided physics engine environment */
 void print_physics_engine_environment(
     const struct physics_engine_environment *env);
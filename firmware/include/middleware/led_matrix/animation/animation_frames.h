@@ -2,11 +2,18 @@
 #define __ANIMATION_FRAMES_H__
 
 #include "led_matrix.h"
+#include "packed_animation.h"
 
 extern volatile struct led_matrix runtime_animation[1];
 
+/*
+ * An animation is either stored as plain frames in `animation_map_values` or
+ * packed in flash in `animation_map_packed`, the other entry is NULL.
+ */
 extern volatile struct led_matrix *animation_map_values[3];
 
+extern const struct packed_animation *animation_map_packed[3];
+
 extern uint32_t animation_map_lens[3];
 
 #endif /* __ANIMATION_FRAMES_H__ */
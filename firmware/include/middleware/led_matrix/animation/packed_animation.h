@@ -0,0 +1,53 @@
+#ifndef __PACKED_ANIMATION_H__
+#define __PACKED_ANIMATION_H__
+
+#include <stdint.h>
+
+#include "led_matrix.h"
+
+/*
+ * Packed animations are generated by scripts/frame_generator.py and stay in
+ * flash. Each frame is stored in one of two encodings, whichever is smaller:
+ *
+ *  * A key frame holds every led as 3 bits, led 0 in the lowest bits of the
+ * first byte and row by row from there, for 19 bytes per frame.
+ *  * A delta frame holds only the leds that changed since the previous frame
+ * as a run of tokens. Each token is one byte, the top 5 bits are how many
+ * unchanged leds to skip and the low 3 bits are the new value of the led
+ * after them. A value of PACKED_ANIMATION_SKIP only skips, for gaps longer
+ * than a single token can hold.
+ *
+ * The index table holds the offset of each frame in the data, plus one entry
+ * for the end of the data, with PACKED_ANIMATION_KEY_FRAME set on key frames.
+ * The first frame is always a key frame so playback can start anywhere by
+ * going back to the nearest key frame.
+ */
+#define PACKED_ANIMATION_KEY_FRAME 0x8000U
+#define PACKED_ANIMATION_OFFSET_MASK 0x7FFFU
+#define PACKED_ANIMATION_SKIP 7U
+
+struct packed_animation {
+    const uint8_t *data;
+    const uint16_t *index;  // `n_frames` + 1 entries
+    uint32_t n_frames;
+};
+
+/*
+ * Keeps the last decoded frame so that playing an animation in order only
+ * applies one delta per frame.
+ */
+struct packed_animation_cursor {
+    const struct packed_animation *anim;
+    uint32_t next_frame;
+    struct led_matrix frame;
+};
+
+/*
+ * Decodes frame `frame_n` of `anim` into `out`.
+ * Returns 0 on success or -EINVAL if the frame does not exist.
+ */
+int packed_animation_decode(struct packed_animation_cursor *cursor,
+                            const struct packed_animation *anim,
+                            uint32_t frame_n, struct led_matrix *out);
+
+#endif /* __PACKED_ANIMATION_H__ */
@@ -13,15 +13,26 @@ struct sprite {
     const uint32_t height;      // Height of the sprite map
 } __attribute__((aligned(4)));
 
+/* Sprite positions can be offset by fractions of 1 / (1 << this) of an led */
+#define SPRITE_SUBPIXEL_BITS 4
+#define SPRITE_SUBPIXELS (1 << SPRITE_SUBPIXEL_BITS)
+
 /*
  * Sprite components are the individual instances that have modified positions
  * and are owned by other structs. Specify which sprite to use and its position
  * within the 7x7 matrix.
+ *
+ * `x` and `y` are the nearest led. `x_frac` and `y_frac` are how far off it
+ * the sprite really is, in the range -SPRITE_SUBPIXELS / 2 to
+ * SPRITE_SUBPIXELS / 2, and are only used by the subpixel renderer. Leaving
+ * them 0 places the sprite exactly on the led.
  */
 struct sprite_component {
     const struct sprite *map;  // The sprite this object references
     int x;                     // X position of the sprite
     int y;                     // Y position of the sprite
+    int8_t x_frac;             // X offset from `x` in subpixels
+    int8_t y_frac;             // Y offset from `y` in subpixels
 } __attribute__((aligned(4)));
 
 // Provide a list of externed sprite objects so others can reference it
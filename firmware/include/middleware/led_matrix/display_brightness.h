@@ -0,0 +1,44 @@
+#ifndef __DISPLAY_BRIGHTNESS_H__
+#define __DISPLAY_BRIGHTNESS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Display brightness follows the ambient light sensor:
+ *  * The lux reading is smoothed so a passing shadow does not pump the
+ * display. The display stays at full duty until the sensor delivers its
+ * first reading, which then seeds the smoothing.
+ *  * The smoothed lux is bucketed by quarter octaves and looked up in the
+ * tables generated into display_luts.h by scripts/lut_generator.c, giving
+ * the charlieplex duty and scan rate for that much light.
+ *  * A bucket is only acted on once the light has moved more than
+ * DISPLAY_BRIGHTNESS_HYSTERESIS buckets, and the duty then steps towards
+ * its new value by DISPLAY_BRIGHTNESS_STEP per run so changes fade in.
+ *
+ * Dark rooms get a dimmer display and a slower scan, saving led current
+ * and interrupts.
+ */
+#define DISPLAY_BRIGHTNESS_PERIOD_MS 100U
+
+/* Buckets the light has to move by before the display follows it */
+#define DISPLAY_BRIGHTNESS_HYSTERESIS 1
+
+/* Most the duty changes by per run, out of CHARLIEPLEX_DUTY_FULL */
+#define DISPLAY_BRIGHTNESS_STEP 8U
+
+/* Smoothing of the lux reading, each run moves 1 / (1 << this) of the way */
+#define DISPLAY_BRIGHTNESS_FILTER_SHIFT 2
+
+/*
+ * Turns the controller on or off. When off the display is left at full
+ * duty and refresh rate.
+ */
+void display_brightness_enable(bool enable);
+
+/* Duty and refresh rate the display is running at */
+void display_brightness_get(uint32_t *duty, uint32_t *refresh_rate);
+
+void display_brightness_run(void);
+
+#endif /* __DISPLAY_BRIGHTNESS_H__ */
@@ -0,0 +1,76 @@
+#ifndef __DISPLAY_TELEMETRY_H__
+#define __DISPLAY_TELEMETRY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Display telemetry follows frames through the led matrix pipeline:
+ *  * The game engine marks each update of the game state.
+ *  * The renderer stamps the sprite frame it finishes with the time of the
+ * update it was drawn from, or with the time it finished if there was none.
+ *  * The compositor stamps the frame it commits to the ring with the oldest
+ * stamp of the layer frames it took.
+ *  * The assembler reports each frame it hands to the charlieplex driver or
+ * skips as already on display, and the time since its stamp is kept as the
+ * frame's latency.
+ *
+ * Frames per second are measured from the driver's count of frames swapped
+ * onto the leds, sampled every DISPLAY_TELEMETRY_WINDOW_MS. Latency
+ * percentiles are over the last DISPLAY_TELEMETRY_N_LATENCIES frames.
+ *
+ * Each hook is a timestamp and a store, so this is always on.
+ */
+#define DISPLAY_TELEMETRY_WINDOW_MS 1000U
+
+#define DISPLAY_TELEMETRY_N_LATENCIES 32
+
+/*
+ * Dump the statistics on this period over the uart logger, 0 to only dump
+ * when display_telemetry_dump() is called, as the widget controller does
+ * on a double tap along the z axis.
+ */
+#define DISPLAY_TELEMETRY_DUMP_PERIOD_MS 0U
+
+struct display_telemetry {
+    uint32_t fps_x10;         // Frames reaching the leds per 10 seconds
+    uint32_t latency_p50_us;  // Game update to driver, median
+    uint32_t latency_p99_us;  // Game update to driver, 99th percentile
+    uint32_t n_shown;         // Frames swapped onto the leds
+    uint32_t n_dropped;       // Frames replaced before they were shown
+    uint32_t n_repeats;       // Scans that reshowed a stale frame
+    uint32_t n_underruns;     // Times the assembler found no frame waiting
+    uint32_t n_skipped;       // Frames skipped as identical to the display
+};
+
+/* Called by the game engine each time it updates the game state */
+void display_telemetry_mark_update(void);
+
+/*
+ * Called when the renderer finishes a frame. Returns the frame's stamp, the
+ * time of the game update it shows or now if there was no new update.
+ */
+uint32_t display_telemetry_frame_rendered(void);
+
+/* Called when the compositor commits a frame stamped `stamp` to `slot` */
+void display_telemetry_frame_committed(uint32_t slot, uint32_t stamp);
+
+/*
+ * Called when the frame from ring slot `slot` is handed to the driver, or
+ * skipped as identical to the frame on display
+ */
+void display_telemetry_frame_drawn(uint32_t slot);
+
+void display_telemetry_get(struct display_telemetry *telemetry);
+
+/*
+ * Requests a dump of the statistics over the uart, printed a line at a time
+ * by `display_telemetry_run`.
+ */
+void display_telemetry_dump(void);
+
+bool display_telemetry_is_ready(void);
+
+void display_telemetry_run(void);
+
+#endif /* __DISPLAY_TELEMETRY_H__ */
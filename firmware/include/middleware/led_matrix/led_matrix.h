@@ -5,10 +5,59 @@
 #include "stm32l0xx_hal.h"
 
 /*
- * Defines how large the buffers are for storing assembled, loaded and
- * renderered frames
+ * Depth of the ring of loaded and rendered frames waiting to be assembled.
+ * The producer can run this many frames ahead of the display.
  */
-#define LED_MATRIX_BUFFER_SIZE 2
+#define LED_MATRIX_BUFFER_SIZE 3
+
+/* Brightest value a single led can take in a struct led_matrix */
+#define LED_MATRIX_MAX_BRIGHTNESS CHARLIEPLEX_MAX_BRIGHTNESS
+
+/*
+ * How the renderer walks the sprites:
+ *  * `LED_MATRIX_RENDER_PIXEL` renders one pixel per call by checking every
+ * sprite against it. Each call is short so it has the lowest jitter.
+ *  * `LED_MATRIX_RENDER_FRAME` renders the whole frame per call by blitting
+ * each sprite once. It does far less work per frame.
+ *  * `LED_MATRIX_RENDER_SUBPIXEL` renders the whole frame per call like
+ * `LED_MATRIX_RENDER_FRAME`, but also places each sprite by the fraction of
+ * an led it is off its nearest led. Each sprite pixel is spread over the up
+ * to four leds it covers by area, so motion is smooth instead of stepping a
+ * whole led at a time.
+ */
+#define LED_MATRIX_RENDER_PIXEL 0
+#define LED_MATRIX_RENDER_FRAME 1
+#define LED_MATRIX_RENDER_SUBPIXEL 2
+
+#define LED_MATRIX_RENDER_MODE LED_MATRIX_RENDER_SUBPIXEL
+
+/*
+ * The compositor builds each frame from these layers, blended in this order
+ * from the bottom up.
+ */
+enum led_matrix_layer_id {
+    LED_MATRIX_LAYER_ANIMATION,  // Filled by the loader
+    LED_MATRIX_LAYER_SPRITES,    // Filled by the renderer
+    LED_MATRIX_LAYER_TEXT,       // Scrolling text and other overlays
+    N_LED_MATRIX_LAYERS,
+};
+
+/*
+ * How a layer is blended onto the layers below it, after its leds are
+ * scaled by the layer's opacity:
+ *  * `LED_MATRIX_BLEND_ADD` adds the two and saturates.
+ *  * `LED_MATRIX_BLEND_MAX` keeps the brighter of the two.
+ *  * `LED_MATRIX_BLEND_REPLACE` mixes the layer over what is below by its
+ * opacity, so an opaque layer hides everything below it.
+ */
+enum led_matrix_blend {
+    LED_MATRIX_BLEND_ADD,
+    LED_MATRIX_BLEND_MAX,
+    LED_MATRIX_BLEND_REPLACE,
+    N_LED_MATRIX_BLENDS,
+};
+
+#define LED_MATRIX_OPACITY_OPAQUE 255U
 
 /*
  * Create a map so the widget controller can reference animation frames
@@ -40,27 +89,47 @@ struct led_matrix {
     Dimming is achieved through leaving some leds off for part of the sub
     frames.
 
+    The loader and renderer each fill their own layer rather than a whole
+    frame. A layer keeps its last contents, so the animation, the sprites
+    and any text overlay are produced independently and at their own pace.
+    The compositor blends the enabled layers into a frame whenever one of
+    them is updated or a layer is turned on or off. If no layer changed
+    since the last frame it reuses that frame instead of blending again.
+    A layer only counts as enabled while its source stage is active, so
+    switching between the animation and the game still switches what is
+    shown.
+
     A common issue with drawing is image tearing, which happens when writing
     to a buffer while the buffer is being displayed. This is avoided by
-    creating two buffers and providing a pointer for where the writing should
-    go and where the drawer should read from. Two pointers, the 'front' and
-    'back' pointers select which buffer should be used for reading and writing.
-    Flipping the pointers lets you avoid a memcpy and prevents image tearing.
+    passing frames from the compositor (the producer) to the assembler (the
+    consumer) through a single producer, single consumer ring
+    of LED_MATRIX_BUFFER_SIZE slots. The producer acquires the slot at the
+    head, fills it and commits it. The consumer reads the oldest committed
+    slot and releases it once assembled. Each side only moves its own index,
+    so neither needs a lock and a slot is never written while it is read.
+    When the ring is full the producer waits, when it is empty the assembler
+    waits and the driver keeps showing the last frame. The assembler also
+    waits while the driver has a frame it has not shown yet, so the ring
+    fills at the display rate and holds the sources to it.
 
     Function Descriptions:
 
-    The loader function loads the next frame of animation and saves it to a
-    pointer for the assembler to use.
+    The loader function loads the next frame of animation into the
+    animation layer.
 
-    The assembler uses a struct led_matrix and creates a set number of
-    subframes. The ratio of on-time and off-time provided by the led_matrix
-    determines how often a single led is on. A single call to the assembler
-    will process a single led for all of the subframes. The assembler can
-    take a new struct led_matrix as input from any function, as long as:
-        (1). It updates the struct led_matrix *current_frame pointer value.
-        (2). It unsets the 'assembler_needs_frame' flag.
-        (3). It only updates the 'current_frame' pointer when requested.
-    These are inplace to avoid image tearing.
+    The renderer draws the game entities into the sprite layer.
+
+    The compositor blends the layers into the next slot of the ring.
+
+    The assembler takes the oldest frame in the ring, packs it into the
+    brightness bit-planes the driver draws from (see charlieplex_planes) and
+    hands it to the driver, all in a single call. Packing once per frame is
+    all the planes are used for, the layers are blended led by led.
+
+    Each composed frame is hashed when it is finished. If the
+    assembler is given a frame whose hash matches the one on display, it
+    marks itself finished without assembling or redrawing it, so a static
+    scene costs the driver nothing.
 
     The drawer takes in a complete list of sub frames and draws them.
     There is no logic to alert the assembler when finished. It just
@@ -77,25 +146,79 @@ uint32_t get_anim_length(enum animation_map anim);
 void led_matrix_setup(void);
 
 /*
- * Loads the animation frame specified one pixel per iteration.
- * Data is stored in the specified slot in 'matrix_buff' for the context.
+ * Loads the whole animation frame specified into the animation layer.
  * Signals when finished.
  */
 void led_matrix_loader_run(void);
 
 /*
  * This function only focuses on rendering stuff
- * Renders a single led per iteration. Stores the data in the specified slot
- * in 'matrix_buff' for the context. Signals when finished.
+ * Renders a single led or a whole frame per iteration depending on
+ * LED_MATRIX_RENDER_MODE. The finished frame is stored in the sprite layer.
+ * Signals when finished.
  */
 void led_matrix_renderer_run(void);
 
 /*
- * Assembles all the subframes for a single led per iteration.
+ * Blends the enabled layers into a frame and commits it to the ring.
+ */
+void led_matrix_compositor_run(void);
+
+/*
+ * Assembles a whole frame per iteration.
  * Signals when finished.
  */
 void led_matrix_assembler_run(void);
 
+/*
+ * Returns true if the stage is active and still has a frame to produce.
+ * Used by the job scheduler so that idle stages are not dispatched.
+ */
+bool led_matrix_loader_is_ready(void);
+bool led_matrix_renderer_is_ready(void);
+bool led_matrix_compositor_is_ready(void);
+bool led_matrix_assembler_is_ready(void);
+
+/*
+ * Sets how `layer` is blended onto the layers below it.
+ * Returns 0 on success or -EINVAL for an unknown layer or blend mode.
+ */
+int led_matrix_layer_configure(enum led_matrix_layer_id layer,
+                               enum led_matrix_blend blend, uint8_t opacity);
+
+/*
+ * Turns `layer` on or off. The animation and sprite layers are also off
+ * while the loader or renderer feeding them is inactive.
+ * Returns 0 on success or -EINVAL for an unknown layer.
+ */
+int led_matrix_layer_enable(enum led_matrix_layer_id layer, bool enable);
+
+/*
+ * Replaces the contents of `layer` with `frame`. The compositor only blends
+ * the layers again if the contents changed.
+ * Returns 0 on success or -EINVAL for an unknown layer.
+ */
+int led_matrix_layer_update(enum led_matrix_layer_id layer,
+                            const struct led_matrix *frame);
+
+/*
+ * Frames the assembler handed to the driver and frames it skipped because
+ * they matched what was already on display, along with the state of the
+ * frame ring. An underrun is counted each time the assembler wants a frame
+ * and finds the ring empty.
+ */
+struct led_matrix_frame_stats {
+    uint32_t n_processed;
+    uint32_t n_skipped;
+    uint32_t occupancy;      // Frames in the ring right now
+    uint32_t max_occupancy;  // Most frames seen in the ring at once
+    uint32_t n_underruns;
+};
+
+void led_matrix_get_frame_stats(struct led_matrix_frame_stats *stats);
+
+void led_matrix_reset_frame_stats(void);
+
 void pause_led_matrix();
 void unpause_led_matrix();
 
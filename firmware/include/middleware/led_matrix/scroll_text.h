@@ -1,9 +1,59 @@
 #ifndef __SCROLL_TEXT_H__
 #define __SCROLL_TEXT_H__
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/* Each character is 5 columns of glyph followed by 2 blank columns */
+#define SCROLL_TEXT_CHAR_WIDTH 7
+
+/* Brightness of a lit led of text */
+#define SCROLL_TEXT_BRIGHTNESS 4
+
+/*
+ * Columns held by the strip. It only needs the two characters a 7 column
+ * window can span, and is a power of two so wrapping is a mask.
+ */
+#define SCROLL_TEXT_STRIP_LEN 16
+
+/*
+ * Text being scrolled, rasterised a character at a time into a strip of
+ * columns as the window reaches it. Each column is a byte with bit n set if
+ * the led in row n is lit, so a scroll step is a copy of 7 bytes out of the
+ * strip rather than a decode of every glyph in view.
+ *
+ * The strip only keeps the characters in view, so there is no limit on the
+ * length of the text. The text is not copied and has to stay valid while it
+ * is scrolled.
+ */
+struct scroll_text {
+    const char* text;
+    size_t len;
+    uint32_t hash;      // Hash of the text, to tell when it changes
+    size_t strip_char;  // First character in the strip
+    size_t next_char;   // First character not in the strip yet
+    uint8_t strip[SCROLL_TEXT_STRIP_LEN];
+};
+
+/*
+ * Sets the text to scroll. Returns true if it differs from the text already
+ * set, in which case scrolling should start again from the beginning.
+ */
+bool scroll_text_set(struct scroll_text* scroll, const char* text);
+
+/* Number of columns the text scrolls through */
+static inline size_t scroll_text_n_columns(const struct scroll_text* scroll) {
+    return scroll->len * SCROLL_TEXT_CHAR_WIDTH;
+}
+
+/*
+ * Fills `frame` with the 7 columns of text starting at `column`. Columns past
+ * the end of the text are blank.
+ */
+void scroll_text_window(struct scroll_text* scroll, size_t column,
+                        uint8_t frame[7][7]);
+
 void generate_frame(const char* text, size_t len, int scroll_position,
                     uint8_t frame[7][7]);
 
-#endif /*__SCROLL_TEXT_H__*/
\ No newline at end of file
+#endif /*__SCROLL_TEXT_H__*/
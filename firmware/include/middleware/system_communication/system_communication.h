@@ -41,6 +41,7 @@ struct driver_comm_message_passing {
 
         struct {
             uint16_t proximity, als;
+            bool valid;  // Set once the first reading has arrived
         } ambient_light;
 
         struct {
@@ -80,7 +81,6 @@ struct driver_comm_shared_memory {
                 bool finished;                  // Is the loader finished
                 enum animation_map input_anim;  // Which animation to read from
                 uint32_t input_frame;           // Which frame to read from
-                uint32_t output_slot;           // Which slot to write to
                 uint32_t row;                   // Which row to process
                 uint32_t col;                   // Which column to process
             } loader;
@@ -90,7 +90,6 @@ struct driver_comm_shared_memory {
                 bool finished;            // Is the renderer finished
                 struct game_entity *entities;  // Array of entities to draw
                 uint32_t num_entities;    // How many sprites are in the array
-                uint32_t output_slot;     // Which slot to write to
                 uint32_t row;             // Which row to process
                 uint32_t col;             // Which column to process
             } renderer;
@@ -98,7 +97,7 @@ struct driver_comm_shared_memory {
             struct {
                 bool active;           // Should the assembler be on
                 bool finished;         // Is the assembler finished
-                uint32_t input_slot;   // Which slot to read from
+                uint32_t input_slot;   // Ring slot being read
                 uint32_t output_slot;  // which slot to write to
                 uint32_t row;          // Which row to process
                 uint32_t col;          // Which column to process
@@ -142,4 +141,9 @@ void system_communication_setup(void);
 */
 void system_communication_run(void);
 
+/*
+    Returns true if there is an i2c request queued and the bus is free
+*/
+bool system_communication_is_pending(void);
+
 #endif /* __SYSTEM_COMMUNICATION_H__ */
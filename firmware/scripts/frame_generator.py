@@ -14,6 +14,12 @@
     The ppm images provided must be RGB and can be larger than 7x7.
     The images will be converted to grayscale, scaled to 7x7 and then
     scaled to the correct brightness range.
+
+    Each animation is emitted as a struct packed_animation that stays in
+    flash, see include/middleware/led_matrix/animation/packed_animation.h
+    for the format. Every frame is stored either as a key frame of 3 bits
+    per led or as the changes from the previous frame, whichever is smaller.
+    The compression ratio against one byte per led is printed to stderr.
 '''
 
 import cv2
@@ -25,6 +31,13 @@ from natsort import natsorted
 # This is the same as the max brightness define in include/led_matrix.h
 MAX_VALUE = 4
 
+# These must match include/middleware/led_matrix/animation/packed_animation.h
+N_LEDS = 7 * 7
+KEY_FRAME = 0x8000
+MAX_OFFSET = 0x7FFF
+SKIP = 7
+MAX_SKIP = 31
+
 
 # Define the functions we need
 def add_header():
@@ -33,43 +46,92 @@ def add_header():
 
 def add_includes():
     print("")
-    print("#include \"led_matrix.h\"")
+    print("#include \"packed_animation.h\"")
     print("")
 
 def add_footer():
     print("#endif /* __GENERATED_ANIMATION_FRAMES_H__ */")
 
-def add_frame_header(name):
-    print("struct led_matrix ", name, "[] = {", sep="")
-
-def add_frame_footer():
+# Pack every led as 3 bits, led 0 in the lowest bits of the first byte
+def pack_key_frame(leds):
+    out = bytearray()
+    bits = 0
+    n_bits = 0
+    for value in leds:
+        bits |= value << n_bits
+        n_bits += 3
+        while n_bits >= 8:
+            out.append(bits & 0xFF)
+            bits >>= 8
+            n_bits -= 8
+    if n_bits > 0:
+        out.append(bits & 0xFF)
+    return out
+
+# Encode only the leds that differ from the previous frame
+def pack_delta_frame(prev, leds):
+    out = bytearray()
+    skip = 0
+    for old, new in zip(prev, leds):
+        if old == new:
+            skip += 1
+            continue
+        while skip > MAX_SKIP:
+            out.append((MAX_SKIP << 3) | SKIP)
+            skip -= MAX_SKIP
+        out.append((skip << 3) | new)
+        skip = 0
+    return out
+
+# Returns the packed data and the index table for a list of frames
+def pack_animation(frames):
+    data = bytearray()
+    index = []
+    prev = None
+    for leds in frames:
+        key = pack_key_frame(leds)
+        delta = pack_delta_frame(prev, leds) if prev is not None else None
+        if delta is None or len(key) <= len(delta):
+            index.append(len(data) | KEY_FRAME)
+            data += key
+        else:
+            index.append(len(data))
+            data += delta
+        prev = leds
+    index.append(len(data))
+
+    if len(data) > MAX_OFFSET:
+        sys.exit("animation is too large to index")
+
+    return data, index
+
+def add_packed_animation(name, frames, data, index):
+    print("/* ", name, ": ", len(frames), " frames */", sep="")
+    print("static const uint8_t ", name, "_data[] = {", sep="")
+    for i in range(0, len(data), 12):
+        print("\t", ", ".join("0x%02X" % b for b in data[i:i + 12]), ",",
+              sep="")
+    if len(data) == 0:
+        print("\t0,")
+    print("};")
+    print("")
+    print("static const uint16_t ", name, "_index[] = {", sep="")
+    for i in range(0, len(index), 8):
+        print("\t", ", ".join("0x%04X" % v for v in index[i:i + 8]), ",",
+              sep="")
+    print("};")
+    print("")
+    print("const struct packed_animation ", name, " = {", sep="")
+    print("\t.data = ", name, "_data,", sep="")
+    print("\t.index = ", name, "_index,", sep="")
+    print("\t.n_frames = ", len(frames), ",", sep="")
     print("};")
     print("")
 
-def add_matrix_entry_header(name):
-    print("\t{")
-    print("\t\t/* ", name," */", sep="")
-    print("\t\t.mat = {")
-
-# Print all the data for the matrix with braces around each row
-def add_matrix_data(data):
-    for i in range(0,7):
-        print("\t\t\t{", end = "")
-        for j in range(0,7):
-            value = int(round(data[i][j], 0)) # bring to closest int
-            print(value, end = "")
-
-            # Format output nicely
-            if(j == 6):
-                pass
-            else:
-                print(", ", end = "", sep = "")
-
-        print("},")
-
-def add_matrix_entry_footer():
-    print("\t\t}")
-    print("\t},")
+def report_ratio(name, raw_size, packed_size):
+    ratio = raw_size / packed_size if packed_size else 0
+    print("%s: %d -> %d bytes (%.2f:1)" % (name, raw_size, packed_size,
+                                          ratio), file=sys.stderr)
 
 
 def main():
@@ -86,10 +148,12 @@ def main():
     add_header()
     add_includes()
 
+    total_raw = 0
+    total_packed = 0
+
     # Begin generating each animation
     for animation in animations:    
-        # we have a new led_matrix array to fill
-        add_frame_header(animation)
+        frame_data = []
 
         # go into the folder
         os.chdir(base_path + "/" + animation)
@@ -105,12 +169,22 @@ def main():
             image = cv2.resize(image, (7,7))
             image = (image / 255.0) * MAX_VALUE
             
-            # add the matrix entry to the array
-            add_matrix_entry_header(animation + "/" + frame)
-            add_matrix_data(image)
-            add_matrix_entry_footer()
-
-        add_frame_footer()
+            # bring each led to the closest int, row by row
+            leds = [int(round(image[i][j], 0)) for i in range(0, 7)
+                    for j in range(0, 7)]
+            frame_data.append(leds)
+
+        data, index = pack_animation(frame_data)
+        add_packed_animation(animation, frame_data, data, index)
+
+        # One byte per led was the previous format
+        raw_size = len(frame_data) * N_LEDS
+        packed_size = len(data) + 2 * len(index)
+        report_ratio(animation, raw_size, packed_size)
+        total_raw += raw_size
+        total_packed += packed_size
+
+    report_ratio("total", total_raw, total_packed)
 
     # End header file
     add_footer()
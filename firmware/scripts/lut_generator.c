@@ -114,7 +114,238 @@ void gen_lut_tables(struct lut_entry *entries, int size) {
     printf("#endif /* __LMATH_LUTS_H__ */\n");
 }
 
+/*
+    Ambient light is bucketed by quarter octaves of lux + 1: the bucket is
+    4 times the index of the highest set bit plus the next two bits below
+    it. This must match display_brightness_lux_index() in the firmware.
+    Returns the lowest lux in bucket 'index'.
+*/
+double lux_from_index(int index) {
+    int msb = index / 4;
+    int frac = index % 4;
+
+    return (4 + frac) * pow(2.0, msb - 2) - 1.0;
+}
+
+/*
+    Generates the tables the display brightness controller maps ambient
+    light through:
+     * The duty follows the ambient light with a gamma curve, so the display
+    dims in step with how dark the room looks, and never goes below a floor
+    so it stays readable in the dark.
+     * The scan rate is lowered in dark rooms where the dimmer display hides
+    the extra flicker, saving interrupts.
+    Both are out of 255.
+*/
+#define DISPLAY_LUT_SIZE 60         // Covers the 14 bits of lux from the ALS
+#define DISPLAY_FULL_LUX 400.0      // Lux at which the display is at full duty
+#define DISPLAY_GAMMA 2.2           // Perceptual curve from lux to duty
+#define DISPLAY_MIN_DUTY 0.15       // Dimmest the display is allowed to go
+#define DISPLAY_DARK_LUX 8.0        // At or below this the rate is lowest
+#define DISPLAY_BRIGHT_LUX 64.0     // At or above this the rate is full
+#define DISPLAY_MIN_RATE 0.75       // Lowest scan rate, as part of the full
+
+void gen_display_luts(void) {
+    printf("#ifndef __DISPLAY_LUTS_H__\n");
+    printf("#define __DISPLAY_LUTS_H__\n\n");
+    printf("#include <stdint.h>\n\n\n");
+
+    printf("/*************************************\n");
+    printf("\tThis is a generated file from\n");
+    printf("\tscripts/lut_generator.c display\n");
+    printf("**************************************/\n\n\n");
+
+    printf("#define DISPLAY_LUT_SIZE %d\n\n", DISPLAY_LUT_SIZE);
+
+    printf("static const uint8_t display_duty_lut[] = {\n\t");
+    for (int i = 0; i < DISPLAY_LUT_SIZE; i++) {
+        double x = lux_from_index(i) / DISPLAY_FULL_LUX;
+        double duty = pow(x < 1.0 ? x : 1.0, 1.0 / DISPLAY_GAMMA);
+        if (duty < DISPLAY_MIN_DUTY) {
+            duty = DISPLAY_MIN_DUTY;
+        }
+        printf("%s%d", i == 0 ? "" : (i % 10 == 0 ? ",\n\t" : ", "),
+               (int)lround(duty * 255.0));
+    }
+    printf("\n};\n\n");
+
+    printf("static const uint8_t display_rate_lut[] = {\n\t");
+    for (int i = 0; i < DISPLAY_LUT_SIZE; i++) {
+        double lux = lux_from_index(i);
+        double t = (log2(lux + 1.0) - log2(DISPLAY_DARK_LUX + 1.0)) /
+                   (log2(DISPLAY_BRIGHT_LUX + 1.0) -
+                    log2(DISPLAY_DARK_LUX + 1.0));
+        t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+        double rate = DISPLAY_MIN_RATE + (1.0 - DISPLAY_MIN_RATE) * t;
+        printf("%s%d", i == 0 ? "" : (i % 10 == 0 ? ",\n\t" : ", "),
+               (int)lround(rate * 255.0));
+    }
+    printf("\n};\n\n");
+
+    printf("#endif /* __DISPLAY_LUTS_H__ */\n");
+}
+
+/*
+    Generates the bit-plane code each led brightness is shown with by the
+    charlieplex driver. Bit n of a code is lit for 2^n units of time, so the
+    code is the on time. The codes follow a gamma curve so the brightness
+    levels look evenly spaced, rather than the on time being.
+
+    An optional calibration file evens out leds that are brighter than the
+    rest. Each line is an led name from the schematic and the part of full
+    on time it should get, for example "D29 0.8". '#' starts a comment. With
+    a calibration file every led gets its own row of codes.
+*/
+#define LED_LEVELS 5  // CHARLIEPLEX_MAX_BRIGHTNESS + 1
+#define LED_PLANES 3  // CHARLIEPLEX_N_PLANES
+#define LED_MAX_CODE ((1 << LED_PLANES) - 1)
+#define LED_DEFAULT_GAMMA 2.2
+
+// Schematic number of each led, in the order of 'enum leds' in the driver
+static const int led_names[] = {
+    67, 5,  9,  7,  57, 58, 83, 17, 71, 19, 18, 59, 24, 23, 75, 12, 13,
+    11, 25, 79, 26, 68, 6,  10, 8,  60, 61, 84, 20, 72, 22, 21, 62, 27,
+    80, 76, 15, 16, 14, 28, 32, 33, 29, 31, 30, 36, 37, 35, 34,
+};
+
+#define N_LEDS (int)(sizeof(led_names) / sizeof(led_names[0]))
+
+/*
+    Fills in the code for every level at 'scale' of full on time. Every lit
+    level gets at least one unit more than the level below it, so no two
+    levels look the same however dim the curve makes them.
+*/
+void gen_led_codes(double gamma, double scale, int codes[LED_LEVELS]) {
+    codes[0] = 0;
+    for (int level = 1; level < LED_LEVELS; level++) {
+        double x = (double)level / (LED_LEVELS - 1);
+        int code = (int)lround(LED_MAX_CODE * scale * pow(x, gamma));
+
+        if (code <= codes[level - 1]) {
+            code = codes[level - 1] + 1;
+        }
+        codes[level] = code < LED_MAX_CODE ? code : LED_MAX_CODE;
+    }
+}
+
+void print_led_codes(const int codes[LED_LEVELS]) {
+    printf("{");
+    for (int level = 0; level < LED_LEVELS; level++) {
+        printf("%s%d", level == 0 ? "" : ", ", codes[level]);
+    }
+    printf("}");
+}
+
+/* Reads the calibration file into 'scales', every led not in it is 1.0 */
+void read_led_calibration(const char *path, double scales[N_LEDS]) {
+    char line[128];
+    int line_number = 0;
+
+    for (int i = 0; i < N_LEDS; i++) {
+        scales[i] = 1.0;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open calibration file '%s'\n", path);
+        exit(1);
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int name;
+        double scale;
+        char *comment = strchr(line, '#');
+
+        line_number++;
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        if (sscanf(line, " D%d %lf", &name, &scale) != 2 || scale <= 0.0 ||
+            scale > 1.0) {
+            fprintf(stderr, "%s:%d: expected 'D<n> <scale>' with a scale in "
+                    "(0, 1]\n", path, line_number);
+            exit(1);
+        }
+
+        int i = 0;
+        while (i < N_LEDS && led_names[i] != name) {
+            i++;
+        }
+        if (i == N_LEDS) {
+            fprintf(stderr, "%s:%d: no led D%d\n", path, line_number, name);
+            exit(1);
+        }
+        scales[i] = scale;
+    }
+
+    fclose(file);
+}
+
+void gen_charlieplex_luts(double gamma, const char *calibration) {
+    int codes[LED_LEVELS];
+
+    printf("#ifndef __CHARLIEPLEX_LUTS_H__\n");
+    printf("#define __CHARLIEPLEX_LUTS_H__\n\n");
+    printf("#include <stdint.h>\n\n\n");
+
+    printf("/*************************************\n");
+    printf("\tThis is a generated file from\n");
+    printf("\tscripts/lut_generator.c charlieplex\n");
+    printf("**************************************/\n\n\n");
+
+    printf("#define CHARLIEPLEX_LUT_LEVELS %d\n", LED_LEVELS);
+    printf("#define CHARLIEPLEX_LUT_PLANES %d\n", LED_PLANES);
+    printf("#define CHARLIEPLEX_LUT_CALIBRATED %d\n\n", calibration != NULL);
+
+    printf("// Gamma %.2f\n", gamma);
+    printf("static const uint8_t charlieplex_code_lut[] = ");
+    gen_led_codes(gamma, 1.0, codes);
+    print_led_codes(codes);
+    printf(";\n\n");
+
+    if (calibration != NULL) {
+        double scales[N_LEDS];
+
+        read_led_calibration(calibration, scales);
+
+        printf("// Calibrated from %s\n", calibration);
+        printf("static const uint8_t charlieplex_led_code_lut[][%d] = {\n",
+               LED_LEVELS);
+        for (int i = 0; i < N_LEDS; i++) {
+            gen_led_codes(gamma, scales[i], codes);
+            printf("\t");
+            print_led_codes(codes);
+            printf(",  // D%d\n", led_names[i]);
+        }
+        printf("};\n\n");
+    }
+
+    printf("#endif /* __CHARLIEPLEX_LUTS_H__ */\n");
+}
+
 int main(int argc, char **argv) {
+    // The display tables go to their own header
+    if (argc > 1 && strcmp(argv[1], "display") == 0) {
+        gen_display_luts();
+        return 0;
+    }
+
+    // So do the charlieplex codes: [gamma] [calibration file]
+    if (argc > 1 && strcmp(argv[1], "charlieplex") == 0) {
+        double gamma = argc > 2 ? atof(argv[2]) : LED_DEFAULT_GAMMA;
+        if (gamma <= 0.0) {
+            fprintf(stderr, "Gamma must be positive\n");
+            exit(1);
+        }
+
+        gen_charlieplex_luts(gamma, argc > 3 ? argv[3] : NULL);
+        return 0;
+    }
+
     // Specify all functions here
     struct lut_entry entries[] = {
         {"sqrt", 0, 8, 256, 10},  {"sin", -4, 4, 256, 10},
@@ -1,7 +1,9 @@
 #include "charlieplex_driver.h"
 
+#include <errno.h>
 #include <stdbool.h>
 
+#include "charlieplex_luts.h"
 #include "logging.h"
 #include "stm32l072xx.h"
 #include "utils.h"
@@ -16,13 +18,37 @@ struct charlieplex_driver_config {
     TIM_TypeDef *tim;
 } __attribute__((aligned(4)));
 
+/*
+ * Each subframe is shown once per bit-plane and then blanked. The blank
+ * phase comes last in the sequence of phases.
+ */
+#define BLANK_PHASE CHARLIEPLEX_N_PLANES
+#define N_PHASES (CHARLIEPLEX_N_PLANES + 1)
+
+/* Number of timer updates it takes to scan out a whole frame */
+#define N_SCAN_STEPS (__NUM_LED_FRAMES * N_PHASES)
+
+/* Shortest step, in timer counts, the interrupt can reliably keep up with */
+#define MIN_STEP_COUNTS 64U
+
+/*
+ * A single timer update's worth of register writes. `arr` is the length of
+ * the step after this one since the auto-reload is preloaded.
+ */
+struct charlieplex_scan_step {
+    uint32_t moder;
+    uint32_t odr;
+    uint32_t arr;
+};
+
 struct charlieplex_driver_context {
     TIM_HandleTypeDef htim;
     volatile uint8_t *leds[2];
-    volatile uint32_t moder_buffer[2][__NUM_LED_FRAMES];
+    struct charlieplex_scan_step scan_out[2][N_SCAN_STEPS];
     volatile uint8_t current_buffer;
     volatile bool update_requested;
-    volatile enum led_frame current_frame;
+    volatile uint8_t current_step;
+    volatile struct charlieplex_driver_stats stats;
 } __attribute__((aligned(4)));
 
 struct charlieplex_driver {
@@ -31,7 +57,7 @@ struct charlieplex_driver {
 } __attribute__((aligned(4)));
 
 static const struct charlieplex_driver_config config = {
-    .refresh_rate = 180U,
+    .refresh_rate = CHARLIEPLEX_REFRESH_RATE,
     .tim = TIM7,
 };
 
@@ -44,7 +70,7 @@ static struct charlieplex_driver_context context = {
         },
     .current_buffer = 0,
     .update_requested = false,
-    .current_frame = LED_FRAME_1,
+    .current_step = 0,
 };
 
 static const struct charlieplex_driver charlieplex_driver_inst = {
@@ -303,20 +329,176 @@ static const uint32_t low_moder[NUM_LEDS] = {
     [D34] = ctrl_output_mode_map[low[D34]],
 };
 
-static void charlieplex_driver_prepare_frames(uint8_t *leds) {
-    struct charlieplex_driver_context *context = charlieplex_driver->context;
+/*
+ * The bit-plane code of each brightness comes from charlieplex_luts.h. Bit
+ * `n` is shown for 2^n units of time so the on time is proportional to the
+ * code, and the codes follow the gamma the tables were generated with.
+ */
+#if CHARLIEPLEX_LUT_LEVELS != CHARLIEPLEX_MAX_BRIGHTNESS + 1 || \
+    CHARLIEPLEX_LUT_PLANES != CHARLIEPLEX_N_PLANES
+#error "charlieplex_luts.h does not match the driver, run 'make clean'"
+#endif
+
+// Bit of each led in the words of a struct charlieplex_planes, per subframe
+static uint32_t frame_mask[__NUM_LED_FRAMES][CHARLIEPLEX_N_WORDS];
+
+static void charlieplex_driver_init_frame_masks(void) {
     for (int led_frame = 0; led_frame < __NUM_LED_FRAMES; led_frame++) {
-        uint32_t moder = led_frame_ctrl_moder[led_frame];
-        enum leds *frame_leds = frame_led_map[led_frame];
         for (int i = 0; i < led_count[led_frame]; i++) {
-            moder |= low_moder
-                [leds[frame_leds
-                          [i]]];  // ctrl_output_mode_map[mode[leds[led_idx]][led_idx]];
+            uint32_t bit = frame_led_map[led_frame][i] - 1U;
+            frame_mask[led_frame][bit / 32U] |= 1U << (bit % 32U);
         }
-        context->moder_buffer[context->current_buffer ^ 1U][led_frame] = moder;
     }
 }
 
+/* Index of the single set bit in `bit`, the M0+ has no count zeros */
+static inline uint32_t bit_index(uint32_t bit) {
+    static const uint8_t debruijn_index[32] = {
+        0,  1,  28, 2,  29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4,  8,
+        31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6,  11, 5,  10, 9,
+    };
+
+    return debruijn_index[(bit * 0x077CB531U) >> 27];
+}
+
+#if CHARLIEPLEX_LUT_CALIBRATED
+/*
+ * Turns brightness planes into code planes: bit `n` of `code[p]` is set if
+ * led `n + 1` is lit during bit-plane `p`. Every led has its own calibrated
+ * codes, so each lit led gathers its brightness from the planes and looks
+ * its code up. Anything brighter than the maximum is shown at the maximum.
+ */
+static void charlieplex_driver_code_planes(
+    const struct charlieplex_planes *planes,
+    uint32_t code[CHARLIEPLEX_N_PLANES][CHARLIEPLEX_N_WORDS]) {
+    for (int word = 0; word < CHARLIEPLEX_N_WORDS; word++) {
+        uint32_t lit = 0;
+
+        for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+            code[plane][word] = 0;
+        }
+        for (int b = 0; b < CHARLIEPLEX_BRIGHTNESS_BITS; b++) {
+            lit |= planes->word[b][word];
+        }
+
+        while (lit != 0) {
+            uint32_t bit = lit & -lit;
+            uint32_t index = bit_index(bit);
+            uint32_t level = 0;
+            lit ^= bit;
+
+            for (int b = 0; b < CHARLIEPLEX_BRIGHTNESS_BITS; b++) {
+                level |= ((planes->word[b][word] >> index) & 1U) << b;
+            }
+            if (level > CHARLIEPLEX_MAX_BRIGHTNESS) {
+                level = CHARLIEPLEX_MAX_BRIGHTNESS;
+            }
+
+            uint32_t led_code =
+                charlieplex_led_code_lut[32U * word + index][level];
+            for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+                if ((led_code >> plane) & 1U) {
+                    code[plane][word] |= bit;
+                }
+            }
+        }
+    }
+}
+#else
+/*
+ * Turns brightness planes into code planes: bit `n` of `code[p]` is set if
+ * led `n + 1` is lit during bit-plane `p`. Each brightness level is picked
+ * out with a mask across the whole word, anything brighter than the maximum
+ * is shown at the maximum.
+ */
+static void charlieplex_driver_code_planes(
+    const struct charlieplex_planes *planes,
+    uint32_t code[CHARLIEPLEX_N_PLANES][CHARLIEPLEX_N_WORDS]) {
+    for (int word = 0; word < CHARLIEPLEX_N_WORDS; word++) {
+        uint32_t below = 0;  // Leds dimmer than the current level
+
+        for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+            code[plane][word] = 0;
+        }
+
+        for (uint32_t level = 0; level <= CHARLIEPLEX_MAX_BRIGHTNESS;
+             level++) {
+            uint32_t mask = ~below;
+
+            if (level < CHARLIEPLEX_MAX_BRIGHTNESS) {
+                for (int b = 0; b < CHARLIEPLEX_BRIGHTNESS_BITS; b++) {
+                    uint32_t bits = planes->word[b][word];
+                    mask &= (level >> b) & 1U ? bits : ~bits;
+                }
+                below |= mask;
+            }
+
+            for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+                if ((charlieplex_code_lut[level] >> plane) & 1U) {
+                    code[plane][word] |= mask;
+                }
+            }
+        }
+    }
+}
+#endif
+
+static void charlieplex_driver_prepare_frames(
+    const struct charlieplex_planes *planes) {
+    struct charlieplex_driver_context *context = charlieplex_driver->context;
+    uint8_t back_buffer = context->current_buffer ^ 1U;
+    uint32_t code[CHARLIEPLEX_N_PLANES][CHARLIEPLEX_N_WORDS];
+
+    charlieplex_driver_code_planes(planes, code);
+
+    for (int led_frame = 0; led_frame < __NUM_LED_FRAMES; led_frame++) {
+        struct charlieplex_scan_step *steps =
+            &context->scan_out[back_buffer][led_frame * N_PHASES];
+
+        for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+            uint32_t moder = led_frame_ctrl_moder[led_frame];
+
+            // Only visit the leds of this subframe lit in this plane
+            for (int word = 0; word < CHARLIEPLEX_N_WORDS; word++) {
+                uint32_t bits = code[plane][word] & frame_mask[led_frame][word];
+                while (bits != 0) {
+                    uint32_t bit = bits & -bits;
+                    bits ^= bit;
+                    moder |= low_moder[1U + 32U * word + bit_index(bit)];
+                }
+            }
+
+            steps[plane].moder = moder;
+        }
+    }
+}
+
+void charlieplex_driver_draw_planes(const struct charlieplex_planes *planes) {
+    struct charlieplex_driver_context *context = charlieplex_driver->context;
+
+    /*
+     * Withdraw any frame still waiting to be shown before overwriting the
+     * back buffer, otherwise the interrupt could swap it in half written.
+     */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool pending = context->update_requested;
+    context->update_requested = false;
+    __set_PRIMASK(primask);
+
+    if (pending) {
+        context->stats.n_dropped++;
+    }
+
+    charlieplex_driver_prepare_frames(planes);
+    context->stats.n_draws++;
+    context->update_requested = true;
+}
+
+bool charlieplex_driver_is_pending(void) {
+    return charlieplex_driver->context->update_requested;
+}
+
 /*
     Draw a 'frame' of leds.
 
@@ -324,19 +506,123 @@ static void charlieplex_driver_prepare_frames(uint8_t *leds) {
     the enum 'leds' defined above.
 */
 void charlieplex_driver_draw(uint8_t *leds) {
-    struct charlieplex_driver_context *context = charlieplex_driver->context;
+    struct charlieplex_planes planes;
 
-    charlieplex_driver_prepare_frames(leds);
-    context->update_requested = true;
+    // Skip the dummy led
+    charlieplex_planes_pack(&planes, &leds[1]);
+    charlieplex_driver_draw_planes(&planes);
 }
 
-static inline void charlieplex_driver_draw_frame(uint8_t *leds,
-                                                 enum led_frame led_frame) {
+/*
+ * Works out the timer period of each phase of a subframe.
+ *
+ * The refresh rate sets the length of a tick. As before, a subframe takes
+ * three ticks: at full duty it is lit for one and blanked for two to limit
+ * current draw. The lit part is `duty` of a tick, split between the
+ * bit-planes in proportion to their weights, and the rest of the three
+ * ticks is blank.
+ */
+static int charlieplex_driver_phase_periods(
+    struct charlieplex_driver_context *context, uint32_t refresh_rate,
+    uint32_t duty, uint32_t phase_period[N_PHASES]) {
+    const struct charlieplex_driver_config *cfg = charlieplex_driver->config;
+    uint32_t tick =
+        (context->htim.Init.Period + 1U) * cfg->refresh_rate / refresh_rate;
+    uint32_t lit = tick * duty / CHARLIEPLEX_DUTY_FULL;
+    uint32_t total_weight = (1U << CHARLIEPLEX_N_PLANES) - 1U;
+    uint32_t lit_total = 0;
+
+    for (int plane = 0; plane < CHARLIEPLEX_N_PLANES; plane++) {
+        uint32_t length = (lit << plane) / total_weight;
+        if (length < MIN_STEP_COUNTS) {
+            length = MIN_STEP_COUNTS;
+        }
+        phase_period[plane] = length - 1U;
+        lit_total += length;
+    }
+
+    // The auto-reload register is 16 bits
+    uint32_t blank = (3U * tick) - lit_total;
+    if (blank < MIN_STEP_COUNTS || blank > 0x10000U) {
+        return -EINVAL;
+    }
+    phase_period[BLANK_PHASE] = blank - 1U;
+
+    return 0;
+}
+
+/*
+ * Writes the period of every step into both scan-out buffers. Each is a
+ * single word, so the interrupt at worst scans one frame with a mix of the
+ * old and new timing.
+ */
+static void charlieplex_driver_write_periods(
+    struct charlieplex_driver_context *context,
+    const uint32_t phase_period[N_PHASES]) {
+    for (int buffer = 0; buffer < 2; buffer++) {
+        for (int step = 0; step < N_SCAN_STEPS; step++) {
+            context->scan_out[buffer][step].arr =
+                phase_period[(step + 1) % N_PHASES];
+        }
+    }
+}
+
+int charlieplex_driver_set_timing(uint32_t refresh_rate, uint32_t duty) {
+    const struct charlieplex_driver_config *cfg = charlieplex_driver->config;
     struct charlieplex_driver_context *context = charlieplex_driver->context;
+    uint32_t phase_period[N_PHASES];
 
-    GPIOC->ODR = 0U;
-    GPIOC->MODER = context->moder_buffer[context->current_buffer][led_frame];
-    GPIOC->ODR = led_frame_ctrl_odr[led_frame];
+    if (refresh_rate == 0 || refresh_rate > cfg->refresh_rate ||
+        duty > CHARLIEPLEX_DUTY_FULL) {
+        return -EINVAL;
+    }
+
+    int ret = charlieplex_driver_phase_periods(context, refresh_rate, duty,
+                                               phase_period);
+    if (ret < 0) {
+        return ret;
+    }
+
+    charlieplex_driver_write_periods(context, phase_period);
+
+    return 0;
+}
+
+/*
+ * Lays out the parts of the scan-out that never change, the control line
+ * levels, and the timing of every step at the full refresh rate and duty.
+ * Blank steps are left all zero.
+ * Returns 0 on success or -EINVAL if the full rate and duty do not fit the
+ * timer.
+ */
+static int charlieplex_driver_init_scan_out(
+    struct charlieplex_driver_context *context) {
+    const struct charlieplex_driver_config *cfg = charlieplex_driver->config;
+    uint32_t phase_period[N_PHASES];
+
+    int ret = charlieplex_driver_phase_periods(
+        context, cfg->refresh_rate, CHARLIEPLEX_DUTY_FULL, phase_period);
+    if (ret < 0) {
+        return ret;
+    }
+    charlieplex_driver_write_periods(context, phase_period);
+
+    for (int buffer = 0; buffer < 2; buffer++) {
+        for (int step = 0; step < N_SCAN_STEPS; step++) {
+            struct charlieplex_scan_step *scan_step =
+                &context->scan_out[buffer][step];
+            int led_frame = step / N_PHASES;
+            int phase = step % N_PHASES;
+
+            scan_step->moder = phase == BLANK_PHASE
+                                   ? 0U
+                                   : led_frame_ctrl_moder[led_frame];
+            scan_step->odr =
+                phase == BLANK_PHASE ? 0U : led_frame_ctrl_odr[led_frame];
+        }
+    }
+
+    return 0;
 }
 
 static int tim7_init(struct charlieplex_driver *charlieplex_driver) {
@@ -355,10 +641,26 @@ static int tim7_init(struct charlieplex_driver *charlieplex_driver) {
         /* TIM7 Initialization Error */
         return -1;
     }
+
+    int ret = charlieplex_driver_init_scan_out(context);
+    if (ret < 0) {
+        /* Scan-out timing out of range for the timer */
+        return ret;
+    }
+
+    // Preload the period of the first step, as the last step would have
+    TIM7->ARR = context->scan_out[0][N_SCAN_STEPS - 1].arr;
+
     LOG_INF("Desired frequency: %x", cfg->refresh_rate);
     LOG_INF("Actual frequency: %d",
             TIM_GET_ACTUAL_UPDATE_FREQUENCY(&context->htim));
 
+    // The clock division does not slow the counter, so check the real rate
+    LOG_INF("Tick rate: %lu, expected %u",
+            HAL_RCC_GetPCLK1Freq() / ((context->htim.Init.Prescaler + 1U) *
+                                      (context->htim.Init.Period + 1U)),
+            CHARLIEPLEX_TICK_RATE);
+
     TIM_ClockConfigTypeDef clock_source_config = {0};
     clock_source_config.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
     if (HAL_TIM_ConfigClockSource(&context->htim, &clock_source_config)) {
@@ -395,9 +697,11 @@ void charlieplex_driver_init(void) {
     int ret;
 
     gpio_init();
+    charlieplex_driver_init_frame_masks();
     ret = tim7_init(charlieplex_driver);
     if (ret != 0) {
         LOG_ERR("Failed to initialize TIM7: %d", ret);
+        return;
     }
 
     ret = HAL_TIM_Base_Start(&context->htim);
@@ -406,35 +710,48 @@ void charlieplex_driver_init(void) {
     }
 }
 
+/*
+ * Each update plays the next step of the scan-out: one of a subframe's
+ * bit-planes or the blank between subframes. The handler only copies three
+ * precomputed words, the buffers are swapped once the whole frame is out so
+ * a new frame never tears across subframes.
+ */
 void TIM7_IRQHandler(void) {
     struct charlieplex_driver_context *context = charlieplex_driver->context;
-    static uint8_t stage = 0;
-    static const enum led_frame next_frame[] = {
-        [LED_FRAME_1] = LED_FRAME_2, [LED_FRAME_2] = LED_FRAME_3,
-        [LED_FRAME_3] = LED_FRAME_4, [LED_FRAME_4] = LED_FRAME_5,
-        [LED_FRAME_5] = LED_FRAME_1,
-    };
 
     // Clear the update interrupt flag
     __HAL_TIM_CLEAR_IT(&context->htim, TIM_IT_UPDATE);
 
-    if (context->update_requested) {
-        context->current_buffer ^= 1U;
-        context->update_requested = false;
-    }
+    uint8_t step = context->current_step;
+    const struct charlieplex_scan_step *scan_step =
+        &context->scan_out[context->current_buffer][step];
 
-    /* Write frame every other update to reduce current draw */
-    if (stage < 2) {
-        GPIOC->MODER = 0U;
-        GPIOC->ODR = 0U;
-        stage++;
-    } else {
-        charlieplex_driver_draw_frame(context->leds[context->current_buffer],
-                                      context->current_frame);
-
-        context->current_frame = next_frame[context->current_frame];
-        stage = 0;
+    GPIOC->ODR = 0U;
+    GPIOC->MODER = scan_step->moder;
+    GPIOC->ODR = scan_step->odr;
+    TIM7->ARR = scan_step->arr;
+
+    if (++step == N_SCAN_STEPS) {
+        step = 0;
+        if (context->update_requested) {
+            context->current_buffer ^= 1U;
+            context->update_requested = false;
+            context->stats.n_shown++;
+        } else {
+            context->stats.n_repeats++;
+        }
     }
+    context->current_step = step;
+}
+
+void charlieplex_driver_get_stats(struct charlieplex_driver_stats *stats) {
+    struct charlieplex_driver_context *context = charlieplex_driver->context;
+
+    // The counters are each a single word so a torn copy is harmless
+    stats->n_draws = context->stats.n_draws;
+    stats->n_shown = context->stats.n_shown;
+    stats->n_repeats = context->stats.n_repeats;
+    stats->n_dropped = context->stats.n_dropped;
 }
 
 void pause_charlieplex_driver(void) {
@@ -2,6 +2,7 @@
 
 #include <errno.h>
 
+#include "job_queue.h"
 #include "logging.h"
 #include "stm32l0xx_hal.h"
 #include "utils.h"
@@ -61,6 +62,7 @@ int i2c_enqueue_request(struct i2c_driver_context *i2c_context,
     queue_context->end++;
     queue_context->end &= (QUEUE_LENGTH - 1);
     queue_context->n_elts_used++;
+    job_event_post(JOB_EVENT_I2C_QUEUED);
 
     return 0;
 }
@@ -172,10 +174,14 @@ static void complete_callback(I2C_HandleTypeDef *i2c) {
     struct i2c_queue_context *queue_context = &i2c_context->queue_context;
     struct i2c_request *current_request = queue_context->current_request;
 
+    uint32_t events = JOB_EVENT_I2C_DONE;
+
     if (current_request != NULL) {
         future_finish(&current_request->future);
+        events |= current_request->done_events;
     }
     atomic_store(&queue_context->i2c_bus_in_use, I2C_FREE);
+    job_event_post(events);
 }
 
 void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *i2c) {
@@ -192,9 +198,13 @@ void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *i2c) {
     struct i2c_queue_context *queue_context = &i2c_context->queue_context;
     struct i2c_request *current_request = queue_context->current_request;
 
+    uint32_t events = JOB_EVENT_I2C_DONE;
+
     if (current_request != NULL) {
         future_error_out(&current_request->future, -EIO);
+        events |= current_request->done_events;
     }
+    job_event_post(events);
 }
 
 void HAL_I2C_AbortCallback(I2C_HandleTypeDef *i2c) {
@@ -203,7 +213,11 @@ void HAL_I2C_AbortCallback(I2C_HandleTypeDef *i2c) {
     struct i2c_queue_context *queue_context = &i2c_context->queue_context;
     struct i2c_request *current_request = queue_context->current_request;
 
+    uint32_t events = JOB_EVENT_I2C_DONE;
+
     if (current_request != NULL) {
         future_error_out(&current_request->future, -ECONNABORTED);
+        events |= current_request->done_events;
     }
+    job_event_post(events);
 }
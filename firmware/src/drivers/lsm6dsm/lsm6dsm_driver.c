@@ -6,6 +6,7 @@
 #include "futures.h"
 #include "generic_gpio.h"
 #include "i2c_driver.h"
+#include "job_queue.h"
 #include "logging.h"
 #include "lsm6dsm_registers.h"
 #include "system_communication.h"
@@ -247,7 +248,7 @@ static const struct lsm6dsm_driver_config lsm6dsm_config = {
         {
             .tap_x = DISABLE,
             .tap_y = ENABLE,
-            .tap_z = DISABLE,
+            .tap_z = ENABLE,  // Debug dumps, see the widget controller
             .threshold_mg = 180.0f,  // 156.25f,
             .dur_ms = 770,
             .quite_ms = 10,
@@ -780,6 +781,7 @@ int lsm6dsm_driver_init(const struct lsm6dsm_driver *const dev) {
     tilt_it_source_request->num_bytes = 1;
     request->future.state = FUTURE_WAITING;
     request->future.error_number = 0;
+    request->done_events = JOB_EVENT_I2C_ACCELERATION;
 
     /*
         Configure I2C request for acquiring AWT interrupt source
@@ -791,6 +793,7 @@ int lsm6dsm_driver_init(const struct lsm6dsm_driver *const dev) {
     tilt_it_source_request->num_bytes = 1;
     tilt_it_source_request->future.state = FUTURE_WAITING;
     tilt_it_source_request->future.error_number = 0;
+    tilt_it_source_request->done_events = JOB_EVENT_I2C_ACCELERATION;
 
     /*
         Configure I2C request for clearing AWT interrupt
@@ -802,6 +805,7 @@ int lsm6dsm_driver_init(const struct lsm6dsm_driver *const dev) {
     it_source_request->num_bytes = 1;
     it_source_request->future.state = FUTURE_WAITING;
     it_source_request->future.error_number = 0;
+    it_source_request->done_events = JOB_EVENT_I2C_ACCELERATION;
 
     tap_it_source_request->action = I2C_READ;
     tap_it_source_request->address = LSM6DSM_ID;
@@ -810,6 +814,7 @@ int lsm6dsm_driver_init(const struct lsm6dsm_driver *const dev) {
     tap_it_source_request->num_bytes = 1;
     tap_it_source_request->future.state = FUTURE_WAITING;
     tap_it_source_request->future.error_number = 0;
+    tap_it_source_request->done_events = JOB_EVENT_I2C_ACCELERATION;
 
     /*********************/
     /* Configure LSM6DSM */
@@ -1,5 +1,6 @@
 #include "music_player.h"
 
+#include "job_queue.h"
 #include "logging.h"
 #include "utils.h"
 
@@ -102,20 +103,35 @@ enum music_player_error music_player_play_song(
     struct music_player *music_player, enum Song song) {
     if (music_player->context.state == MUSIC_PLAYER_READY) {
         music_player->context.current_song = song;
+        job_event_post(JOB_EVENT_MUSIC_PLAYER);
         return MUSIC_PLAYER_NO_ERROR;
     }
     return MUSIC_PLAYER_RUN_ERROR;
 }
 
-/* Stop the current song - returns MUSIC_PLAYER_STOP_ERROR on failure */
+/*
+ * Stop the current song - returns MUSIC_PLAYER_STOP_ERROR on failure. The
+ * song is stopped before returning, so the player's job can be switched off
+ * straight after.
+ */
 enum music_player_error music_player_abort_song(
     struct music_player *music_player) {
-    music_player->context.current_song = NO_SONG;
-    if (music_player->context.state == MUSIC_PLAYER_BUSY) {
-        return MUSIC_PLAYER_NO_ERROR;
+    struct music_player_context *context = &music_player->context;
+
+    context->current_song = NO_SONG;
+    if (context->state != MUSIC_PLAYER_BUSY) {
+        return MUSIC_PLAYER_STOP_ERROR;
+    }
+
+    if ((context->error = music_player_core_abort_song(music_player))) {
+        // Let the job log the error
+        context->state = MUSIC_PLAYER_ERROR;
+        job_event_post(JOB_EVENT_MUSIC_PLAYER);
+        return context->error;
     }
 
-    return MUSIC_PLAYER_STOP_ERROR;
+    context->state = MUSIC_PLAYER_READY;
+    return MUSIC_PLAYER_NO_ERROR;
 }
 
 /* Returns true if a song is currently playing, else false */
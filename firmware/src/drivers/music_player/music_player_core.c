@@ -2,6 +2,8 @@
 
 #include <errno.h>
 
+#include "job_queue.h"
+
 #define MUSIC_PLAYER_MAX_VOLUME 10U
 
 #define MUSIC_PLAYER_VOLUME 3U
@@ -517,6 +519,7 @@ void song_complete_callback(DMA_HandleTypeDef *hdma) {
         &CONTAINER_OF(cfg, struct music_player, config)->context;
 
     context->current_song = NO_SONG;
+    job_event_post(JOB_EVENT_MUSIC_PLAYER);
 }
 
 /**
@@ -1,5 +1,6 @@
 #include "uart_logger.h"
 
+#include "job_queue.h"
 #include "printf/printf.h"
 #include "ring_buffer.h"
 #include "stm32l0xx_hal.h"
@@ -54,12 +55,14 @@ void uart_logger_send(const char *s, ...) {
 
     // Transmit the string we just formatted over the UART.
     ring_buffer_push_n(&uart_buffer, str, len);
+    job_event_post(JOB_EVENT_UART);
 
     // And cleanup
     va_end(args);
 }
 
 int uart_logger_send_bytes(const char *bytes, size_t len) {
+    job_event_post(JOB_EVENT_UART);
     return ring_buffer_push_n(&uart_buffer, bytes, len);
 }
 
@@ -76,4 +79,12 @@ void uart_logger_run(void) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+bool uart_logger_is_pending(void) {
+    return !uart_busy && ring_buffer_available_to_read(&uart_buffer) != 0;
+}
+
+bool uart_logger_is_idle(void) {
+    return !uart_busy && ring_buffer_is_empty(&uart_buffer);
+}
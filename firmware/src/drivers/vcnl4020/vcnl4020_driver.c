@@ -4,6 +4,7 @@
 #include <stdatomic.h>
 
 #include "i2c_driver.h"
+#include "job_queue.h"
 #include "stm32l0xx_hal.h"
 #include "utils.h"
 
@@ -60,6 +61,7 @@ int vcnl4020_driver_init(const struct vcnl4020_config *config,
     request->buffer = context->i2c_transaction_buffer;
     request->future.state = FUTURE_WAITING;
     request->future.error_number = 0;
+    request->done_events = JOB_EVENT_I2C_AMBIENT_LIGHT;
 
     /*
         First clear the command register so we can adjust registers safely
@@ -164,6 +166,7 @@ int vcnl4020_driver_init(const struct vcnl4020_config *config,
     it_request->num_bytes = 1;
     it_request->future.state = FUTURE_WAITING;
     it_request->future.error_number = 0;
+    it_request->done_events = JOB_EVENT_I2C_AMBIENT_LIGHT;
 
     // Clear the internal register by saying we have an interrupt to clear
     vcnl4020_interrupt_flag = VCNL4020_INTERRUPT_TRIGGERED;
@@ -0,0 +1,139 @@
+#include "job_profiler.h"
+
+#if JOB_PROFILER_ENABLED
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "stm32l0xx_hal.h"
+#include "uart_logger.h"
+
+#define JOB_PROFILER_SIZE 24
+
+static struct job_profile profiles[JOB_PROFILER_SIZE];
+
+static size_t n_profiles = 0;
+
+/* Next line of the dump to print, or -1 if no dump is in progress */
+static int dump_line = -1;
+
+struct job_profile *job_profiler_get(job_fn_t fn) {
+    for (size_t i = 0; i < n_profiles; i++) {
+        if (profiles[i].fn == fn) {
+            return &profiles[i];
+        }
+    }
+
+    if (n_profiles >= JOB_PROFILER_SIZE) {
+        return NULL;
+    }
+
+    struct job_profile *profile = &profiles[n_profiles++];
+    *profile = (struct job_profile){.fn = fn, .min_cycles = UINT32_MAX};
+    return profile;
+}
+
+int job_profiler_register(job_fn_t fn, const char *name) {
+    struct job_profile *profile = job_profiler_get(fn);
+    if (profile == NULL) {
+        return -ENOMEM;
+    }
+
+    profile->name = name;
+    return 0;
+}
+
+void job_profiler_record(struct job_profile *profile, uint32_t cycles) {
+    if (profile == NULL) {
+        return;
+    }
+
+    profile->count++;
+    profile->total_cycles += cycles;
+    if (cycles < profile->min_cycles) {
+        profile->min_cycles = cycles;
+    }
+    if (cycles > profile->max_cycles) {
+        profile->max_cycles = cycles;
+    }
+
+    size_t bucket = 0;
+    uint32_t limit = JOB_PROFILER_FIRST_BUCKET_CYCLES;
+    while (cycles >= limit && bucket < JOB_PROFILER_N_BUCKETS - 1) {
+        limit <<= 1;
+        bucket++;
+    }
+    profile->histogram[bucket]++;
+}
+
+void job_profiler_reset(void) {
+    for (size_t i = 0; i < n_profiles; i++) {
+        profiles[i] = (struct job_profile){
+            .fn = profiles[i].fn,
+            .name = profiles[i].name,
+            .min_cycles = UINT32_MAX,
+        };
+    }
+}
+
+void job_profiler_dump(void) {
+    if (dump_line < 0) {
+        dump_line = 0;
+    }
+}
+
+/* Only print once the uart has drained the previous line */
+bool job_profiler_is_ready(void) {
+    return dump_line >= 0 && uart_logger_is_idle();
+}
+
+/*
+ * Prints one line of the table per call. Each job takes two lines, one with
+ * the timings and one with the histogram, after a single header line.
+ */
+void job_profiler_run(void) {
+    if (dump_line < 0) {
+        return;
+    }
+
+    if (dump_line == 0) {
+        uart_logger_send("jobs: %u profiled, cycles at %lu Hz\r\n", n_profiles,
+                         SystemCoreClock);
+        dump_line++;
+        return;
+    }
+
+    size_t index = (dump_line - 1) / 2;
+    if (index >= n_profiles) {
+        dump_line = -1;
+        return;
+    }
+
+    struct job_profile *profile = &profiles[index];
+
+    if ((dump_line - 1) % 2 == 0) {
+        uint32_t mean =
+            profile->count ? profile->total_cycles / profile->count : 0;
+        uint32_t total_ms = profile->total_cycles / (SystemCoreClock / 1000U);
+
+        if (profile->name != NULL) {
+            uart_logger_send("%-12s", profile->name);
+        } else {
+            uart_logger_send("%-12p", profile->fn);
+        }
+        uart_logger_send(" n %lu tot %lums min %lu avg %lu max %lu\r\n",
+                         profile->count, total_ms,
+                         profile->count ? profile->min_cycles : 0, mean,
+                         profile->max_cycles);
+    } else {
+        uart_logger_send("%12s", "hist");
+        for (size_t i = 0; i < JOB_PROFILER_N_BUCKETS; i++) {
+            uart_logger_send(" %lu", profile->histogram[i]);
+        }
+        uart_logger_send("\r\n");
+    }
+
+    dump_line++;
+}
+
+#endif /* JOB_PROFILER_ENABLED */
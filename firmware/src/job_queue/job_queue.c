@@ -3,13 +3,35 @@
 #include <errno.h>
 #include <stdatomic.h>
 
+#include "job_profiler.h"
 #include "logging.h"
 #include "stm32l0xx_hal.h"
+#include "uart_logger.h"
 #define QUEUE_SIZE 16
 
+struct job {
+    job_fn_t fn;
+    job_ready_fn_t ready;
+    uint32_t period_ms;
+    uint32_t last_run;  // HAL tick of the last dispatch
+    uint32_t events;
+    volatile uint32_t pending_events;
+    enum job_priority priority;
+    uint32_t overrun_limit;
+    struct job_overrun overrun;
+    uint32_t group;  // Mask of `enum job_group`
+#if JOB_PROFILER_ENABLED
+    struct job_profile *profile;
+#endif
+};
+
 struct job_queue {
-    job_fn_t job_fns[QUEUE_SIZE];
+    struct job jobs[QUEUE_SIZE];
     size_t n_entries;
+
+    // Jobs whose groups are all enabled, the only ones the scheduler looks at
+    struct job *enabled[QUEUE_SIZE];
+    size_t n_enabled;
 };
 
 static struct job_queue job_queues[N_JOB_TYPES];
@@ -18,8 +40,49 @@ static _Atomic enum job_type job_state = JOB_INIT;
 
 static _Atomic int job_errno = 0;
 
+static struct job_queue_stats job_stats;
+
+static uint32_t disabled_groups = 0;
+
+static const struct job_schedule default_schedule = {
+    .priority = JOB_PRIORITY_NORMAL,
+    .period_ms = 0,
+    .ready = NULL,
+    .events = 0,
+    .budget_us = 0,
+    .overrun_limit = 0,
+    .group = JOB_GROUP_NONE,
+};
+
+uint32_t job_queue_timestamp(void) {
+    uint32_t tick, val;
+    do {
+        tick = HAL_GetTick();
+        val = SysTick->VAL;
+    } while (tick != HAL_GetTick());
+
+    uint32_t load = SysTick->LOAD;
+    return tick * (load + 1U) + (load - val);
+}
+
+/* Rebuilds the list of enabled jobs after a job or group change */
+static void job_queue_update_enabled(struct job_queue *queue) {
+    queue->n_enabled = 0;
+    for (size_t n = 0; n < queue->n_entries; n++) {
+        if ((queue->jobs[n].group & disabled_groups) == 0) {
+            queue->enabled[queue->n_enabled++] = &queue->jobs[n];
+        }
+    }
+}
+
 int job_add(job_fn_t fn, enum job_type type) {
-    if (type >= N_JOB_TYPES || type < JOB_INIT) {
+    return job_add_scheduled(fn, type, &default_schedule);
+}
+
+int job_add_scheduled(job_fn_t fn, enum job_type type,
+                      const struct job_schedule *schedule) {
+    if (type >= N_JOB_TYPES || type < JOB_INIT || fn == NULL ||
+        schedule == NULL || schedule->priority >= N_JOB_PRIORITIES) {
         return -EINVAL;
     }
 
@@ -30,12 +93,150 @@ int job_add(job_fn_t fn, enum job_type type) {
         return -ENOMEM;
     }
 
-    queue->job_fns[n] = fn;
+    queue->jobs[n] = (struct job){
+        .fn = fn,
+        .ready = schedule->ready,
+        .period_ms = schedule->period_ms,
+        .last_run = 0,
+        .events = schedule->events,
+        .pending_events = 0,
+        .priority = schedule->priority,
+        .overrun_limit = schedule->overrun_limit,
+        .group = schedule->group,
+        .overrun =
+            {
+                .fn = fn,
+                .budget_cycles = ((uint64_t)schedule->budget_us *
+                                  SystemCoreClock / 1000000U),
+            },
+#if JOB_PROFILER_ENABLED
+        .profile = job_profiler_get(fn),
+#endif
+    };
     queue->n_entries++;
+    job_queue_update_enabled(queue);
 
     return 0;
 }
 
+/*
+ * Returns the most urgent job in the queue that is due, or NULL if there is
+ * none. `due_since` is the tick at which a job became due, so the earliest
+ * one has been waiting the longest.
+ */
+static struct job *job_queue_pick(struct job_queue *queue, uint32_t now) {
+    struct job *best = NULL;
+    uint32_t best_due_since = 0;
+
+    for (size_t i = 0; i < queue->n_enabled; i++) {
+        struct job *job = queue->enabled[i];
+        bool elapsed = now - job->last_run >= job->period_ms;
+        uint32_t due_since = job->last_run + job->period_ms;
+
+        if (job->events != 0) {
+            if (job->pending_events != 0) {
+                due_since = job->last_run;
+            } else if (job->period_ms == 0 || !elapsed) {
+                continue;
+            }
+        } else if (!elapsed) {
+            continue;
+        }
+
+        if (best != NULL) {
+            if (job->priority > best->priority) {
+                continue;
+            }
+            if (job->priority == best->priority &&
+                (int32_t)(due_since - best_due_since) >= 0) {
+                continue;
+            }
+        }
+
+        if (job->ready != NULL && !job->ready()) {
+            continue;
+        }
+
+        best = job;
+        best_due_since = due_since;
+    }
+
+    return best;
+}
+
+/* Runs the job, recording how long it took, and returns the cycles spent */
+static uint32_t job_queue_dispatch(struct job *job) {
+    uint32_t t0 = job_queue_timestamp();
+    job->fn();
+    uint32_t cycles = job_queue_timestamp() - t0;
+
+#if JOB_PROFILER_ENABLED
+    job_profiler_record(job->profile, cycles);
+#endif
+
+    struct job_overrun *overrun = &job->overrun;
+    if (overrun->budget_cycles == 0) {
+        return cycles;
+    }
+
+    if (cycles <= overrun->budget_cycles) {
+        overrun->n_consecutive = 0;
+        return cycles;
+    }
+
+    overrun->n_overruns++;
+    overrun->n_consecutive++;
+    if (cycles > overrun->worst_cycles) {
+        overrun->worst_cycles = cycles;
+    }
+
+    job_stats.n_overruns++;
+    if (cycles > job_stats.worst_overrun_cycles) {
+        job_stats.worst_overrun_fn = job->fn;
+        job_stats.worst_overrun_cycles = cycles;
+    }
+
+    if (job->overrun_limit != 0 &&
+        overrun->n_consecutive >= job->overrun_limit &&
+        atomic_load(&job_state) == JOB_RUN_RUN) {
+        LOG_ERR("Job <%p> overran its budget %lu times in a row", job->fn,
+                overrun->n_consecutive);
+        job_error_state_enter(-ETIMEDOUT);
+    }
+
+    return cycles;
+}
+
+/* Dispatches one due job or sleeps until the next interrupt */
+static void job_queue_schedule(struct job_queue *queue) {
+    struct job *job = job_queue_pick(queue, HAL_GetTick());
+
+    if (job != NULL) {
+        job->last_run = HAL_GetTick();
+        job->pending_events = 0;
+        job_stats.busy_cycles += job_queue_dispatch(job);
+        job_stats.n_dispatches++;
+        return;
+    }
+
+    uint32_t t0 = job_queue_timestamp();
+
+    /*
+     * Check again with interrupts masked so that an interrupt making a job
+     * ready between the check and the WFI cannot be missed. A pending
+     * interrupt still wakes the core, it is then taken once unmasked.
+     */
+    __disable_irq();
+    job = job_queue_pick(queue, HAL_GetTick());
+    if (job == NULL) {
+        __WFI();
+    }
+    __enable_irq();
+
+    job_stats.idle_cycles += job_queue_timestamp() - t0;
+    job_stats.n_idles++;
+}
+
 void job_state_machine_run(void) {
     enum job_type state = atomic_load(&job_state);
     struct job_queue *queue = &job_queues[state];
@@ -55,11 +256,10 @@ void job_state_machine_run(void) {
         [JOB_ERROR_RUN] = JOB_ERROR_RUN,
     };
 
-    if (job_n < queue->n_entries) {
-        // uint32_t t0 = TIM21->CNT;
-        queue->job_fns[job_n]();
-        // uint32_t t1 = TIM21->CNT;
-        // LOG_INF("JOB[%d]:<%p> %d", job_n, queue->job_fns[job_n], t1 - t0);
+    if (next_state[state] == state) {
+        job_queue_schedule(queue);
+    } else if (job_n < queue->n_entries) {
+        job_queue_dispatch(&queue->jobs[job_n]);
         job_n++;
     } else {
         job_n = 0;
@@ -71,3 +271,85 @@ void job_error_state_enter(int error) {
     atomic_store(&job_errno, error);
     atomic_store(&job_state, JOB_ERROR_ENTRY);
 }
+
+void job_group_enable(uint32_t groups) {
+    disabled_groups &= ~groups;
+    job_queue_update_enabled(&job_queues[JOB_RUN_RUN]);
+    job_queue_update_enabled(&job_queues[JOB_ERROR_RUN]);
+}
+
+void job_group_disable(uint32_t groups) {
+    disabled_groups |= groups;
+    job_queue_update_enabled(&job_queues[JOB_RUN_RUN]);
+    job_queue_update_enabled(&job_queues[JOB_ERROR_RUN]);
+}
+
+bool job_group_is_enabled(enum job_group group) {
+    return (disabled_groups & group) == 0;
+}
+
+void job_event_post(uint32_t events) {
+    static const enum job_type run_states[] = {JOB_RUN_RUN, JOB_ERROR_RUN};
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (size_t i = 0; i < sizeof(run_states) / sizeof(run_states[0]); i++) {
+        struct job_queue *queue = &job_queues[run_states[i]];
+        for (size_t n = 0; n < queue->n_entries; n++) {
+            queue->jobs[n].pending_events |= events & queue->jobs[n].events;
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void job_queue_get_stats(struct job_queue_stats *stats) {
+    *stats = job_stats;
+}
+
+void job_queue_reset_stats(void) {
+    job_stats = (struct job_queue_stats){0};
+
+    for (size_t type = 0; type < N_JOB_TYPES; type++) {
+        struct job_queue *queue = &job_queues[type];
+        for (size_t n = 0; n < queue->n_entries; n++) {
+            struct job_overrun *overrun = &queue->jobs[n].overrun;
+            overrun->n_overruns = 0;
+            overrun->n_consecutive = 0;
+            overrun->worst_cycles = 0;
+        }
+    }
+}
+
+size_t job_queue_get_overruns(struct job_overrun *overruns, size_t len) {
+    static const enum job_type run_states[] = {JOB_RUN_RUN, JOB_ERROR_RUN};
+    size_t count = 0;
+
+    for (size_t i = 0; i < sizeof(run_states) / sizeof(run_states[0]); i++) {
+        struct job_queue *queue = &job_queues[run_states[i]];
+        for (size_t n = 0; n < queue->n_entries && count < len; n++) {
+            if (queue->jobs[n].overrun.budget_cycles != 0) {
+                overruns[count++] = queue->jobs[n].overrun;
+            }
+        }
+    }
+
+    return count;
+}
+
+void job_queue_log_stats(void) {
+    uint64_t total = job_stats.busy_cycles + job_stats.idle_cycles;
+    uint32_t busy_permille =
+        total ? (uint32_t)(job_stats.busy_cycles * 1000U / total) : 0;
+
+    uart_logger_send("jobs: busy %lu.%lu%% dispatches %lu idles %lu\r\n",
+                     busy_permille / 10, busy_permille % 10,
+                     job_stats.n_dispatches, job_stats.n_idles);
+
+    if (job_stats.worst_overrun_fn != NULL) {
+        uart_logger_send("jobs: %lu overruns, worst <%p> %lu cycles\r\n",
+                         job_stats.n_overruns, job_stats.worst_overrun_fn,
+                         job_stats.worst_overrun_cycles);
+    }
+}
@@ -1,6 +1,9 @@
 #include "acceleration.h"
 #include "ambient_light.h"
+#include "display_brightness.h"
+#include "display_telemetry.h"
 #include "game_engine.h"
+#include "job_profiler.h"
 #include "job_queue.h"
 #include "led_matrix.h"
 #include "music_player.h"
@@ -20,19 +23,148 @@ int main(void) {
     job_add(&music_player_setup, JOB_INIT);
     job_add(&game_engine_setup, JOB_INIT);
 
-    job_add(&uart_logger_run, JOB_RUN_RUN);
-    job_add(&system_communication_run, JOB_RUN_RUN);
+    /*
+     * The led matrix stages feed the display so they run ahead of everything
+     * else whenever they have a frame to produce. The drivers only run when
+     * an interrupt or another job posts one of their events, the sensors
+     * also run on a slow period in case an edge is ever missed.
+     *
+     * Budgets are well above the usual run time of each job, an overrun
+     * means something is holding up the display refresh or the i2c queue.
+     */
+    job_add_scheduled(&led_matrix_loader_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_HIGH,
+                          .ready = &led_matrix_loader_is_ready,
+                          .budget_us = 1000,
+                          .group = JOB_GROUP_DISPLAY | JOB_GROUP_LED_LOADER,
+                      });
+    job_add_scheduled(&led_matrix_renderer_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_HIGH,
+                          .ready = &led_matrix_renderer_is_ready,
+                          .budget_us = 1000,
+                          .group = JOB_GROUP_DISPLAY | JOB_GROUP_LED_RENDERER,
+                      });
+    job_add_scheduled(&led_matrix_compositor_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_HIGH,
+                          .ready = &led_matrix_compositor_is_ready,
+                          .budget_us = 1000,
+                          .group = JOB_GROUP_DISPLAY,
+                      });
+    job_add_scheduled(&led_matrix_assembler_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_HIGH,
+                          .ready = &led_matrix_assembler_is_ready,
+                          .budget_us = 1000,
+                          .group = JOB_GROUP_DISPLAY,
+                      });
 
-    job_add(&acceleration_run, JOB_RUN_RUN);
-    job_add(&ambient_light_run, JOB_RUN_RUN);
+    job_add_scheduled(&system_communication_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_NORMAL,
+                          .ready = &system_communication_is_pending,
+                          .events = JOB_EVENT_I2C_QUEUED | JOB_EVENT_I2C_DONE,
+                          .budget_us = 1000,
+                      });
 
-    job_add(&led_matrix_loader_run, JOB_RUN_RUN);
-    job_add(&led_matrix_renderer_run, JOB_RUN_RUN);
-    job_add(&led_matrix_assembler_run, JOB_RUN_RUN);
+    job_add_scheduled(&acceleration_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_NORMAL,
+                          .period_ms = 100,
+                          .events = JOB_EVENT_ACCELERATION_IT |
+                                    JOB_EVENT_I2C_ACCELERATION |
+                                    JOB_EVENT_SENSOR_REQUEST,
+                          .budget_us = 2000,
+                      });
+    job_add_scheduled(&ambient_light_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_NORMAL,
+                          .period_ms = 100,
+                          .events = JOB_EVENT_AMBIENT_LIGHT_IT |
+                                    JOB_EVENT_I2C_AMBIENT_LIGHT |
+                                    JOB_EVENT_SENSOR_REQUEST,
+                          .budget_us = 2000,
+                      });
 
-    job_add(&music_player_run, JOB_RUN_RUN);
-    job_add(&game_engine_run, JOB_RUN_RUN);
-    job_add(&widget_controller_run, JOB_RUN_RUN);
+    job_add_scheduled(&game_engine_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_NORMAL,
+                          .period_ms = 1,
+                          .budget_us = 20000,
+                          .group = JOB_GROUP_GAME,
+                      });
+    job_add_scheduled(&widget_controller_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_NORMAL,
+                          .period_ms = 1,
+                          .budget_us = 5000,
+                      });
+
+    job_add_scheduled(&uart_logger_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .ready = &uart_logger_is_pending,
+                          .events = JOB_EVENT_UART,
+                          .budget_us = 1000,
+                      });
+    job_add_scheduled(&music_player_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .period_ms = 100,
+                          .events = JOB_EVENT_MUSIC_PLAYER,
+                          .budget_us = 2000,
+                          .group = JOB_GROUP_AUDIO,
+                      });
+
+    job_add_scheduled(&display_brightness_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .period_ms = DISPLAY_BRIGHTNESS_PERIOD_MS,
+                          .group = JOB_GROUP_DISPLAY,
+                      });
+    job_add_scheduled(&display_telemetry_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .ready = &display_telemetry_is_ready,
+                      });
+#if DISPLAY_TELEMETRY_DUMP_PERIOD_MS != 0
+    job_add_scheduled(&display_telemetry_dump, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .period_ms = DISPLAY_TELEMETRY_DUMP_PERIOD_MS,
+                      });
+#endif
+
+#if JOB_PROFILER_ENABLED
+    job_add_scheduled(&job_profiler_run, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .ready = &job_profiler_is_ready,
+                      });
+#if JOB_PROFILER_DUMP_PERIOD_MS != 0
+    job_add_scheduled(&job_profiler_dump, JOB_RUN_RUN,
+                      &(struct job_schedule){
+                          .priority = JOB_PRIORITY_LOW,
+                          .period_ms = JOB_PROFILER_DUMP_PERIOD_MS,
+                      });
+#endif
+#endif
+
+    job_profiler_register(&led_matrix_loader_run, "led_loader");
+    job_profiler_register(&led_matrix_renderer_run, "led_renderer");
+    job_profiler_register(&led_matrix_compositor_run, "led_compositor");
+    job_profiler_register(&led_matrix_assembler_run, "led_assembler");
+    job_profiler_register(&system_communication_run, "sys_comm");
+    job_profiler_register(&acceleration_run, "acceleration");
+    job_profiler_register(&ambient_light_run, "ambient_light");
+    job_profiler_register(&game_engine_run, "game_engine");
+    job_profiler_register(&widget_controller_run, "widget_ctrl");
+    job_profiler_register(&uart_logger_run, "uart_logger");
+    job_profiler_register(&music_player_run, "music_player");
+    job_profiler_register(&display_brightness_run, "display_bright");
+    job_profiler_register(&display_telemetry_run, "display_tele");
 
     while (1) {
         job_state_machine_run();
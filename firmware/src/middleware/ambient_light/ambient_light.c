@@ -1,5 +1,7 @@
 #include "ambient_light.h"
 
+#include "coroutine.h"
+#include "job_queue.h"
 #include "logging.h"
 #include "system_communication.h"
 #include "vcnl4020_driver.h"
@@ -13,6 +15,7 @@ static void ambient_light_update_data(struct driver_comm_message_passing *comm,
                                       struct vcnl4020_context *context) {
     comm->data.ambient_light.proximity = context->proximity_cnt;
     comm->data.ambient_light.als = context->als_lux;
+    comm->data.ambient_light.valid = true;
 }
 
 void ambient_light_setup(void) {
@@ -73,8 +76,41 @@ void ambient_light_setup(void) {
         vcnl4020_context.state = VCNL4020_ERROR;
 }
 
-void ambient_light_run(void) {
+/*
+ * Reads the als and proximity values and hands them to the widget
+ * controller. If the read completes quickly it is processed in the same
+ * dispatch, otherwise the next dispatch resumes at the await.
+ */
+static enum coroutine_status ambient_light_read_run(struct coroutine *co) {
     struct i2c_request *request = &vcnl4020_context.request;
+    struct driver_comm_message_passing *comm = vcnl4020_context.comm;
+
+    COROUTINE_BEGIN(co);
+
+    if (vcnl4020_driver_request_als_prox(&vcnl4020_context) < 0) {
+        vcnl4020_context.state = VCNL4020_ERROR;
+        COROUTINE_EXIT(co);
+    }
+
+    COROUTINE_AWAIT_FUTURE(co, &request->future);
+
+    if (future_is_errored(&request->future)) {
+        vcnl4020_context.state = VCNL4020_ERROR;
+        COROUTINE_EXIT(co);
+    }
+
+    vcnl4020_driver_process_als_prox(&vcnl4020_context);
+    vcnl4020_context.state = VCNL4020_READY;
+
+    // Update communication values
+    comm->request.status = REQUEST_STATUS_FINISHED;
+    ambient_light_update_data(comm, &vcnl4020_context);
+
+    COROUTINE_END(co);
+}
+
+void ambient_light_run(void) {
+    static struct coroutine read_coroutine = COROUTINE_INIT;
     struct i2c_request *it_request = &vcnl4020_context.it_request;
     struct driver_comm_message_passing *comm = vcnl4020_context.comm;
 
@@ -85,6 +121,9 @@ void ambient_light_run(void) {
             if (vcnl4020_interrupt_flag == 1) {
                 vcnl4020_context.it_state = VCNL4020_INTERRUPT_TRIGGERED;
                 vcnl4020_interrupt_flag = 0;  // Unset for next trigger
+
+                // Run again straight away to clear the interrupt
+                job_event_post(JOB_EVENT_AMBIENT_LIGHT_IT);
             }
 
             /* State Machine Start */
@@ -100,13 +139,8 @@ void ambient_light_run(void) {
                         } break;
 
                         case REQUEST_TYPE_DATA: {
-                            int ret = vcnl4020_driver_request_als_prox(
-                                &vcnl4020_context);
-                            if (ret < 0)
-                                vcnl4020_context.state = VCNL4020_ERROR;
-                            else
-                                vcnl4020_context.state = VCNL4020_PENDING;
-
+                            vcnl4020_context.state = VCNL4020_PENDING;
+                            ambient_light_read_run(&read_coroutine);
                         } break;
 
                         case REQUEST_TYPE_ENTER_LP: {
@@ -125,23 +159,7 @@ void ambient_light_run(void) {
                 } break;
 
                 case VCNL4020_PENDING: {
-                    switch (future_get_state(&request->future)) {
-                        case FUTURE_WAITING: {
-                            // Do nothing
-                        } break;
-
-                        case FUTURE_FINISHED: {
-                            vcnl4020_driver_process_als_prox(&vcnl4020_context);
-                            vcnl4020_context.state = VCNL4020_READY;
-                            // Update communication values
-                            comm->request.status = REQUEST_STATUS_FINISHED;
-                            ambient_light_update_data(comm, &vcnl4020_context);
-                        } break;
-
-                        case FUTURE_ERROR: {
-                            vcnl4020_context.state = VCNL4020_ERROR;
-                        } break;
-                    }
+                    ambient_light_read_run(&read_coroutine);
                 } break;
 
                 case VCNL4020_ERROR: {
@@ -1,5 +1,6 @@
 #include "game_engine.h"
 
+#include "display_telemetry.h"
 #include "imp23absu_driver.h"
 #include "led_matrix.h"
 #include "logging.h"
@@ -14,8 +15,10 @@
 extern volatile bool update_requested;
 extern struct driver_comm_shared_memory led_matrix_comm;
 
-#define TICKS_TO_MS(__prescaler__, __clockdiv__, __ticks__) \
-    ((__ticks__ * 1000 * __prescaler__ * __clockdiv__) / (MSI_VALUE))
+#define TICKS_TO_US(__prescaler__, __clockdiv__, __ticks__)           \
+    ((uint32_t)(((uint64_t)(__ticks__) * 1000000U * (__prescaler__) * \
+                 (__clockdiv__)) /                                    \
+                (MSI_VALUE)))
 
 #define CLOCK_DIVISION_VAL_TO_ENUM(__clockdiv__)                            \
     (__clockdiv__ == 1                                                      \
@@ -54,19 +57,6 @@ static void update_game(struct game_engine *game_engine, uint32_t delta_t) {
         case PONG_GAME:
             switch (context->pong_game.context.game_common.game_state) {
                 case GAME_STATE_IN_PROGRESS:
-                    for (int i = 0; i < context->pong_game.context.game_common
-                                            .environment.num_of_entities;
-                         i++) {
-                        context->pong_game.context.game_entities[i].sprite.x =
-                            GET_POSITION_GRID_X(
-                                context->pong_game.context.game_entities[i]
-                                    .entity->rectangle.p1);
-                        context->pong_game.context.game_entities[i].sprite.y =
-                            GET_POSITION_GRID_Y(
-                                context->pong_game.context.game_entities[i]
-                                    .entity->rectangle.p1);
-                    }
-                    pong_game_process_event_queue(&context->pong_game);
                     pong_game_process_input(
                         &context->pong_game,
                         lsm6dsm_driver_get_tilt_flags(lsm6dsm));
@@ -109,27 +99,9 @@ static void update_game(struct game_engine *game_engine, uint32_t delta_t) {
             switch (
                 context->space_invaders_game.context.game_common.game_state) {
                 case GAME_STATE_IN_PROGRESS:
-                    for (int i = 0;
-                         i < context->space_invaders_game.context.game_common
-                                 .environment.num_of_entities;
-                         i++) {
-                        context->space_invaders_game.context.game_entities[i]
-                            .sprite.x = GET_POSITION_GRID_X(
-                            context->space_invaders_game.context
-                                .game_entities[i]
-                                .entity->rectangle.p1);
-                        context->space_invaders_game.context.game_entities[i]
-                            .sprite.y = GET_POSITION_GRID_Y(
-                            context->space_invaders_game.context
-                                .game_entities[i]
-                                .entity->rectangle.p1);
-                    }
-
                     update_space_invaders_game(&context->space_invaders_game,
                                                &context->physics_engine.context
                                                     .random_number_generator);
-                    space_invaders_game_process_event_queue(
-                        &context->space_invaders_game);
                     space_invaders_game_process_input(
                         &context->space_invaders_game,
                         lsm6dsm_driver_get_tilt_flags(lsm6dsm));
@@ -168,45 +140,15 @@ static void update_game(struct game_engine *game_engine, uint32_t delta_t) {
             }
             break;
         case SNOWFALL_GAME:
-            for (int i = 0; i < context->snowfall_game.context.game_common
-                                    .environment.num_of_entities;
-                 i++) {
-                context->snowfall_game.context.game_entities[i].sprite.x =
-                    GET_POSITION_GRID_X(
-                        context->snowfall_game.context.game_entities[i]
-                            .entity->rectangle.p1);
-                context->snowfall_game.context.game_entities[i].sprite.y =
-                    GET_POSITION_GRID_Y(
-                        context->snowfall_game.context.game_entities[i]
-                            .entity->rectangle.p1);
-            }
             update_snowfall_game(
                 &context->snowfall_game,
                 &context->physics_engine.context.random_number_generator,
                 delta_t);
-            snowfall_game_process_event_queue(&context->snowfall_game);
             break;
         case BRICK_BREAKER_GAME:
             switch (
                 context->brick_breaker_game.context.game_common.game_state) {
                 case GAME_STATE_IN_PROGRESS:
-                    for (int i = 0;
-                         i < context->brick_breaker_game.context.game_common
-                                 .environment.num_of_entities;
-                         i++) {
-                        context->brick_breaker_game.context.game_entities[i]
-                            .sprite.x = GET_POSITION_GRID_X(
-                            context->brick_breaker_game.context.game_entities[i]
-                                .entity->rectangle.p1);
-                        context->brick_breaker_game.context.game_entities[i]
-                            .sprite.y = GET_POSITION_GRID_Y(
-                            context->brick_breaker_game.context.game_entities[i]
-                                .entity->rectangle.p1);
-                    }
-                    brick_breaker_game_process_event_queue(
-                        &context->brick_breaker_game,
-                        &context->physics_engine.context
-                             .random_number_generator);
                     brick_breaker_game_process_input(
                         &context->brick_breaker_game,
                         lsm6dsm_driver_get_tilt_flags(lsm6dsm));
@@ -255,13 +197,103 @@ static void update_game(struct game_engine *game_engine, uint32_t delta_t) {
     }
 }
 
+/* Handles the events the last physics step queued for the current game */
+static void process_game_events(struct game_engine *game_engine) {
+    struct game_engine_context *context = &game_engine->context;
+    switch (context->current_game) {
+        case PONG_GAME:
+            if (context->pong_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                pong_game_process_event_queue(&context->pong_game);
+            }
+            break;
+        case SPACE_INVADERS_GAME:
+            if (context->space_invaders_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                space_invaders_game_process_event_queue(
+                    &context->space_invaders_game);
+            }
+            break;
+        case SNOWFALL_GAME:
+            snowfall_game_process_event_queue(&context->snowfall_game);
+            break;
+        case BRICK_BREAKER_GAME:
+            if (context->brick_breaker_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                brick_breaker_game_process_event_queue(
+                    &context->brick_breaker_game,
+                    &context->physics_engine.context.random_number_generator);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Moves the current game's sprites to where the physics left its entities */
+static void sync_game_sprites(struct game_engine *game_engine) {
+    struct game_engine_context *context = &game_engine->context;
+    switch (context->current_game) {
+        case PONG_GAME:
+            if (context->pong_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                game_entities_sync_sprites(
+                    context->pong_game.context.game_entities,
+                    &context->pong_game.context.game_common.environment);
+            }
+            break;
+        case SPACE_INVADERS_GAME:
+            if (context->space_invaders_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                game_entities_sync_sprites(
+                    context->space_invaders_game.context.game_entities,
+                    &context->space_invaders_game.context.game_common
+                         .environment);
+            }
+            break;
+        case SNOWFALL_GAME:
+            game_entities_sync_sprites(
+                context->snowfall_game.context.game_entities,
+                &context->snowfall_game.context.game_common.environment);
+            break;
+        case BRICK_BREAKER_GAME:
+            if (context->brick_breaker_game.context.game_common.game_state ==
+                GAME_STATE_IN_PROGRESS) {
+                game_entities_sync_sprites(
+                    context->brick_breaker_game.context.game_entities,
+                    &context->brick_breaker_game.context.game_common
+                         .environment);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * The games see the frame time in ms, while the physics gets it in us to
+ * run its fixed steps without losing what is left of a ms each frame.
+ *
+ * Each step's events are handled before the next step runs, so a bounce
+ * turns the ball around before it moves on and no bound is reported twice.
+ * The sprites are synced once all the steps are done, with the
+ * interpolation they set.
+ */
 static void update_game_engine(struct game_engine *game_engine,
-                               uint32_t delta_t) {
+                               uint32_t delta_us) {
     struct game_engine_context *context = &game_engine->context;
 
     if (context->current_game != NO_GAME) {
-        update_game(game_engine, delta_t);
-        physics_engine_update(&context->physics_engine, delta_t);
+        update_game(game_engine, delta_us / 1000U);
+
+        uint32_t n_steps =
+            physics_engine_update(&context->physics_engine, delta_us);
+        for (uint32_t n = 0; n < n_steps; n++) {
+            physics_engine_step(&context->physics_engine);
+            process_game_events(game_engine);
+        }
+
+        sync_game_sprites(game_engine);
     }
 }
 
@@ -286,18 +318,19 @@ void game_engine_run(void) {
         if (update_requested) {
             if (__HAL_TIM_GET_FLAG(&context->htim, TIM_FLAG_UPDATE)) {
                 update_game_engine(
-                    &game_engine, TICKS_TO_MS(cfg->prescaler,
+                    &game_engine, TICKS_TO_US(cfg->prescaler,
                                               cfg->clock_division, UINT16_MAX));
                 __HAL_TIM_SET_COUNTER(&context->htim, 0);
                 HAL_TIM_Base_Start(&context->htim);
             } else {
                 update_game_engine(
                     &game_engine,
-                    TICKS_TO_MS(cfg->prescaler, cfg->clock_division,
+                    TICKS_TO_US(cfg->prescaler, cfg->clock_division,
                                 __HAL_TIM_GET_COUNTER(&context->htim)));
                 __HAL_TIM_SET_COUNTER(&context->htim, 0);
             }
             update_requested = false;
+            display_telemetry_mark_update();
         }
 
     } else {
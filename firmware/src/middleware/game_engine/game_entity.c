@@ -4,8 +4,6 @@
 
 bool game_entity_init(struct game_entity *game_entity, struct entity *entity,
                       const struct sprite *sprite) {
-    position pos = entity->rectangle.p1;
-
     if (game_entity == NULL) {
         LOG_ERR(
             "Failed to initialize game entity: <game_entity> must not be NULL");
@@ -18,27 +16,43 @@ bool game_entity_init(struct game_entity *game_entity, struct entity *entity,
     }
 
     game_entity->entity = entity;
-    game_entity->sprite =
-        (struct sprite_component){.map = sprite,
-                                  .x = GET_POSITION_GRID_X(pos),
-                                  .y = GET_POSITION_GRID_Y(pos)};
+    game_entity->sprite = (struct sprite_component){.map = sprite};
+    game_entity_sync_sprite(game_entity);
 
     return true;
 }
 
+void game_entity_sync_sprite(struct game_entity *game_entity) {
+    position pos = get_entity_render_position(game_entity->entity);
+    struct sprite_component *sprite = &game_entity->sprite;
+
+    sprite->x = GET_POSITION_GRID_X(pos);
+    sprite->y = GET_POSITION_GRID_Y(pos);
+
+    // The remainder from the nearest led, in subpixels
+    sprite->x_frac = GET_POSITION_SUBGRID_X(pos, SPRITE_SUBPIXEL_BITS) -
+                     (sprite->x << SPRITE_SUBPIXEL_BITS);
+    sprite->y_frac = GET_POSITION_SUBGRID_Y(pos, SPRITE_SUBPIXEL_BITS) -
+                     (sprite->y << SPRITE_SUBPIXEL_BITS);
+}
+
+void game_entities_sync_sprites(struct game_entity *game_entities,
+                                const struct physics_engine_environment *env) {
+    for (uint32_t n = 0; n < env->num_live; n++) {
+        game_entity_sync_sprite(&game_entities[env->live[n]]);
+    }
+}
+
 void set_game_entity_position(struct game_entity *game_entity,
                               position new_position) {
     set_entity_position(game_entity->entity, new_position);
-    game_entity->sprite.x = GET_POSITION_GRID_X(new_position);
-    game_entity->sprite.y = GET_POSITION_GRID_Y(new_position);
+    game_entity_sync_sprite(game_entity);
 }
 
 void set_game_entity_position_relative(struct game_entity *game_entity,
                                        position relative_position) {
     set_entity_position_relative(game_entity->entity, relative_position);
-    position new_position = get_entity_position(game_entity->entity);
-    game_entity->sprite.x = GET_POSITION_GRID_X(new_position);
-    game_entity->sprite.y = GET_POSITION_GRID_Y(new_position);
+    game_entity_sync_sprite(game_entity);
 }
 
 void set_game_entity_velocity(struct game_entity *game_entity,
@@ -70,13 +84,13 @@ void deactivate_game_entity(struct game_entity *game_entity) {
 }
 
 bool game_entity_is_active(struct game_entity *game_entity) {
-    return game_entity->entity->active;
+    return entity_is_active(game_entity->entity);
 }
 
 void print_game_entity(struct game_entity *game_entity) {
     LOG_INF("\tEntity: %d", game_entity->entity->entity_idx);
-    LOG_INF("\t\t(%d, %d)", game_entity->entity->rectangle.p1.x,
-            game_entity->entity->rectangle.p1.y);
+    LOG_INF("\t\t(%d, %d)", get_entity_position(game_entity->entity).x,
+            get_entity_position(game_entity->entity).y);
     LOG_INF("\tSprite: %d", &game_entity->sprite);
     LOG_INF("\t\t(%d, %d)", game_entity->sprite.x, game_entity->sprite.y);
 }
\ No newline at end of file
@@ -41,6 +41,8 @@ enum entity_creation_error brick_breaker_game_init(
     struct brick_breaker_game_context *context = &brick_breaker_game->context;
 
     game_common_init(&context->game_common);
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context->game_common.environment,
+                                    &context->environment_storage);
 
     /******************/
     /*  Add Entities  */
@@ -137,12 +139,18 @@ brick_breaker_game_process_event_queue(
                 if (IS_BALL_ENTITY(out_of_bounds_event->ent)) {
                     switch (out_of_bounds_event->type) {
                         case OUT_OF_BOUNDS_LEFT: /* fall-through */
-                        case OUT_OF_BOUNDS_RIGHT:
-                            context->ball.entity->velocity.x *= -1;
-                            break;
-                        case OUT_OF_BOUNDS_TOP:
-                            context->ball.entity->velocity.y *= -1;
-                            break;
+                        case OUT_OF_BOUNDS_RIGHT: {
+                            velocity v =
+                                get_game_entity_velocity(&context->ball);
+                            v.x *= -1;
+                            set_game_entity_velocity(&context->ball, v);
+                        } break;
+                        case OUT_OF_BOUNDS_TOP: {
+                            velocity v =
+                                get_game_entity_velocity(&context->ball);
+                            v.y *= -1;
+                            set_game_entity_velocity(&context->ball, v);
+                        } break;
                         case OUT_OF_BOUNDS_BOTTOM: {
                             enum music_player_error error =
                                 music_player_play_song(&music_player,
@@ -234,28 +242,24 @@ brick_breaker_game_process_event_queue(
                     }
                 }
                 /* Clamp the ball velocity to avoid excessive speeds */
-                context->ball.entity->velocity.x =
-                    CLAMP(context->ball.entity->velocity.x,
-                          -BRICK_BREAKER_BALL_MAX_VELOCITY,
-                          BRICK_BREAKER_BALL_MAX_VELOCITY);
-                context->ball.entity->velocity.y =
-                    CLAMP(context->ball.entity->velocity.y,
-                          -BRICK_BREAKER_BALL_MAX_VELOCITY,
-                          BRICK_BREAKER_BALL_MAX_VELOCITY);
-
-                if (context->ball.entity->velocity.x == 0) {
-                    context->ball.entity->velocity.x =
-                        (((int32_t)random_number_generator_get_next_in_n(rng,
-                                                                         4)) -
-                         2);
+                velocity v = get_game_entity_velocity(&context->ball);
+                v.x = CLAMP(v.x, -BRICK_BREAKER_BALL_MAX_VELOCITY,
+                            BRICK_BREAKER_BALL_MAX_VELOCITY);
+                v.y = CLAMP(v.y, -BRICK_BREAKER_BALL_MAX_VELOCITY,
+                            BRICK_BREAKER_BALL_MAX_VELOCITY);
+
+                if (v.x == 0) {
+                    v.x = (((int32_t)random_number_generator_get_next_in_n(rng,
+                                                                           4)) -
+                           2);
                 }
 
-                if (context->ball.entity->velocity.y == 0) {
-                    context->ball.entity->velocity.y =
-                        (((int32_t)random_number_generator_get_next_in_n(rng,
-                                                                         4)) -
-                         2);
+                if (v.y == 0) {
+                    v.y = (((int32_t)random_number_generator_get_next_in_n(rng,
+                                                                           4)) -
+                           2);
                 }
+                set_game_entity_velocity(&context->ball, v);
             } break;
             default:
                 LOG_ERR("Unknown event type: %d", event.type);
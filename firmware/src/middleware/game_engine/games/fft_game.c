@@ -10,6 +10,8 @@ enum entity_creation_error fft_game_init(struct fft_game *fft_game) {
     struct fft_game_context *context = &fft_game->context;
 
     game_common_init(&context->game_common);
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context->game_common.environment,
+                                    &context->environment_storage);
 
     /******************/
     /*  Add Entities  */
@@ -39,6 +39,8 @@ enum entity_creation_error pong_game_init(struct pong_game *pong_game) {
     struct pong_game_context *context = &pong_game->context;
 
     game_common_init(&context->game_common);
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context->game_common.environment,
+                                    &context->environment_storage);
 
     /* Set scores to 0 */
     context->user_score = 0;
@@ -156,11 +158,16 @@ pong_game_process_event_queue(struct pong_game *pong_game) {
                 struct physics_engine_out_of_bounds_event *out_of_bounds_event =
                     &event.out_of_bounds_event;
                 if (IS_OPPONENT_PADDLE_ENTITY(out_of_bounds_event->ent)) {
-                    context->opponent_paddle.entity->velocity.y *= -1;
+                    velocity v =
+                        get_game_entity_velocity(&context->opponent_paddle);
+                    v.y *= -1;
+                    set_game_entity_velocity(&context->opponent_paddle, v);
                 } else if (IS_BALL_ENTITY(out_of_bounds_event->ent)) {
                     if (out_of_bounds_event->type == OUT_OF_BOUNDS_BOTTOM ||
                         out_of_bounds_event->type == OUT_OF_BOUNDS_TOP) {
-                        context->ball.entity->velocity.y *= -1;
+                        velocity v = get_game_entity_velocity(&context->ball);
+                        v.y *= -1;
+                        set_game_entity_velocity(&context->ball, v);
                     } else if (out_of_bounds_event->type ==
                                OUT_OF_BOUNDS_LEFT) {
                         pong_opponent_scores(pong_game);
@@ -184,7 +191,9 @@ pong_game_process_event_queue(struct pong_game *pong_game) {
                 bool other_is_user = other->entity_idx ==
                                      context->user_paddle.entity->entity_idx;
                 if (other_is_user) {
-                    context->ball.entity->velocity.y *= -1;
+                    velocity v = get_game_entity_velocity(&context->ball);
+                    v.y *= -1;
+                    set_game_entity_velocity(&context->ball, v);
                 }
                 if (last_collision_entity != NULL) {
                     if (other->entity_idx ==
@@ -206,17 +215,21 @@ pong_game_process_event_queue(struct pong_game *pong_game) {
                 last_collision_entity = other;
 
                 /* Clamp the ball velocity to avoid excessive speeds */
-                context->ball.entity->velocity.x =
-                    CLAMP(context->ball.entity->velocity.x,
-                          -PONG_BALL_MAX_VELOCITY, PONG_BALL_MAX_VELOCITY);
-                context->ball.entity->velocity.y =
-                    CLAMP(context->ball.entity->velocity.y,
-                          -PONG_BALL_MAX_VELOCITY, PONG_BALL_MAX_VELOCITY);
-                if (context->ball.entity->rectangle.p1.x ==
-                    context->user_paddle.entity->rectangle.p1.x) {
+                velocity v = get_game_entity_velocity(&context->ball);
+                v.x = CLAMP(v.x, -PONG_BALL_MAX_VELOCITY,
+                            PONG_BALL_MAX_VELOCITY);
+                v.y = CLAMP(v.y, -PONG_BALL_MAX_VELOCITY,
+                            PONG_BALL_MAX_VELOCITY);
+                set_game_entity_velocity(&context->ball, v);
+
+                position ball = get_game_entity_position(&context->ball);
+                position user_paddle =
+                    get_game_entity_position(&context->user_paddle);
+                position opponent_paddle =
+                    get_game_entity_position(&context->opponent_paddle);
+                if (ball.x == user_paddle.x) {
                     pong_opponent_scores(pong_game);
-                } else if (context->ball.entity->rectangle.p1.x ==
-                           context->opponent_paddle.entity->rectangle.p1.x) {
+                } else if (ball.x == opponent_paddle.x) {
                     pong_user_scores(pong_game);
                 }
             } break;
@@ -226,13 +239,13 @@ pong_game_process_event_queue(struct pong_game *pong_game) {
         }
     }
     /* Make sure ball never has x velocity 0 */
-    if (context->ball.entity->velocity.x < PONG_BALL_MIN_X_VELOCITY &&
-        context->ball.entity->velocity.x >= 0) {
-        context->ball.entity->velocity.x = PONG_BALL_MIN_X_VELOCITY;
-    } else if (context->ball.entity->velocity.x > -PONG_BALL_MIN_X_VELOCITY &&
-               context->ball.entity->velocity.x <= 0) {
-        context->ball.entity->velocity.x = -PONG_BALL_MIN_X_VELOCITY;
+    velocity v = get_game_entity_velocity(&context->ball);
+    if (v.x < PONG_BALL_MIN_X_VELOCITY && v.x >= 0) {
+        v.x = PONG_BALL_MIN_X_VELOCITY;
+    } else if (v.x > -PONG_BALL_MIN_X_VELOCITY && v.x <= 0) {
+        v.x = -PONG_BALL_MIN_X_VELOCITY;
     }
+    set_game_entity_velocity(&context->ball, v);
 }
 
 void pong_game_process_input(struct pong_game *pong_game,
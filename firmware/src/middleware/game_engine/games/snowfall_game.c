@@ -8,6 +8,8 @@ enum entity_creation_error snowfall_game_init(
     struct snowfall_game_context *context = &snowfall_game->context;
 
     game_common_init(&context->game_common);
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context->game_common.environment,
+                                    &context->environment_storage);
 
     /******************/
     /*  Add Entities  */
@@ -33,6 +35,15 @@ enum entity_creation_error snowfall_game_init(
         }
     }
 
+    int pool = physics_engine_environment_add_pool(
+        &context->game_common.environment,
+        context->snowflakes[0].entity->entity_idx, SNOWFALL_MAX_SNOWFLAKES);
+    if (pool < 0) {
+        LOG_ERR("Failed to create snowflake pool: %d", pool);
+        return ENTITY_CREATION_UNKNOWN_ERROR;
+    }
+    context->snowflake_pool = pool;
+
     context->num_snowflakes = 0;
 
     return 0;
@@ -42,17 +53,14 @@ static struct game_entity *get_next_inactive_snowflake(
     struct snowfall_game *snowfall_game) {
     struct snowfall_game_context *context = &snowfall_game->context;
 
-    uint8_t entity_idx = 0;
-    struct game_entity *snowflake = &context->snowflakes[entity_idx++];
-    while (entity_idx < SNOWFALL_MAX_SNOWFLAKES && snowflake->entity->active) {
-        snowflake = &context->snowflakes[entity_idx++];
-    }
+    struct entity *snowflake = physics_engine_environment_get_free_entity(
+        &context->game_common.environment, context->snowflake_pool);
 
-    if (entity_idx == SNOWFALL_MAX_SNOWFLAKES) {
+    if (snowflake == NULL) {
         return NULL;
     }
 
-    return snowflake;
+    return &context->game_entities[snowflake->entity_idx];
 }
 
 static void place_next_snowflake(struct snowfall_game *snowfall_game,
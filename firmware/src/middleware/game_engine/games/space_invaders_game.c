@@ -69,6 +69,8 @@ enum entity_creation_error space_invaders_game_init(
     struct space_invaders_game_context *context = &space_invaders_game->context;
 
     game_common_init(&context->game_common);
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&context->game_common.environment,
+                                    &context->environment_storage);
 
     /******************/
     /*  Add Entities  */
@@ -141,6 +143,27 @@ enum entity_creation_error space_invaders_game_init(
         }
     }
 
+    /* Keep free lists of the bullets */
+    int pool = physics_engine_environment_add_pool(
+        &context->game_common.environment,
+        SPACE_INVADERS_USER_BULLET_FIRST_ENTITY_IDX,
+        SPACE_INVADERS_MAX_USER_BULLETS);
+    if (pool < 0) {
+        LOG_ERR("Failed to create user bullet pool: %d", pool);
+        return ENTITY_CREATION_UNKNOWN_ERROR;
+    }
+    context->user_bullet_pool = pool;
+
+    pool = physics_engine_environment_add_pool(
+        &context->game_common.environment,
+        SPACE_INVADERS_ENEMY_BULLET_FIRST_ENTITY_IDX,
+        SPACE_INVADERS_MAX_ENEMY_BULLETS);
+    if (pool < 0) {
+        LOG_ERR("Failed to create enemy bullet pool: %d", pool);
+        return ENTITY_CREATION_UNKNOWN_ERROR;
+    }
+    context->enemy_bullet_pool = pool;
+
     activate_game_entity(&context->user_ship);
     for (int i = 0; i < SPACE_INVADERS_NUM_OF_ENEMY_SHIPS; i++) {
         activate_game_entity(&context->enemy_ships[i]);
@@ -203,17 +226,14 @@ enum entity_creation_error space_invaders_shoot_user_bullet(
         /* Probably want to make my own errors for this */
         return ENTITY_CREATION_TOO_MANY_ENTITIES;
     }
-    struct game_entity *bullet = NULL;
-    for (int i = 0; i < SPACE_INVADERS_MAX_USER_BULLETS; i++) {
-        bullet = &context->user_bullets[i];
-        if (!bullet->entity->active) {
-            break;
-        }
-    }
-    if (bullet == NULL) {
-        LOG_ERR("bullet == NULL");
-        while (1);
+    struct entity *free_bullet = physics_engine_environment_get_free_entity(
+        &context->game_common.environment, context->user_bullet_pool);
+    if (free_bullet == NULL) {
+        LOG_ERR("No free bullet to shoot");
+        return ENTITY_CREATION_TOO_MANY_ENTITIES;
     }
+    struct game_entity *bullet =
+        &context->game_entities[free_bullet->entity_idx];
     position bullet_position =
         (position){user_ship_position.x, user_ship_position.y - GRID_UNIT_SIZE};
 
@@ -227,8 +247,10 @@ enum entity_creation_error space_invaders_shoot_user_bullet(
                  r1->p2.y < r2->p1.y);
     }
 
-    if (overlap(&bullet->entity->rectangle,
-                &context->user_ship.entity->rectangle)) {
+    struct rectangle bullet_rectangle = get_entity_rectangle(bullet->entity);
+    struct rectangle user_ship_rectangle =
+        get_entity_rectangle(context->user_ship.entity);
+    if (overlap(&bullet_rectangle, &user_ship_rectangle)) {
         LOG_ERR("User Bullet ALREADY overlaps with User Ship");
     }
 
@@ -254,17 +276,14 @@ enum entity_creation_error space_invaders_shoot_enemy_bullet(
         // Probably want to make my own errors for this
         return ENTITY_CREATION_TOO_MANY_ENTITIES;
     }
-    struct game_entity *bullet = NULL;
-    for (int i = 0; i < SPACE_INVADERS_MAX_ENEMY_BULLETS; i++) {
-        bullet = &context->enemy_bullets[i];
-        if (!bullet->entity->active) {
-            break;
-        }
-    }
-    if (bullet == NULL) {
-        LOG_ERR("bullet == NULL");
-        while (1);
+    struct entity *free_bullet = physics_engine_environment_get_free_entity(
+        &context->game_common.environment, context->enemy_bullet_pool);
+    if (free_bullet == NULL) {
+        LOG_ERR("No free bullet to shoot");
+        return ENTITY_CREATION_TOO_MANY_ENTITIES;
     }
+    struct game_entity *bullet =
+        &context->game_entities[free_bullet->entity_idx];
     position bullet_position = (position){
         enemy_ship_position.x, enemy_ship_position.y + GRID_UNIT_SIZE};
 
@@ -12,59 +12,66 @@ enum entity_validation_error validate_entity_init_struct(
 }
 
 void set_entity_position(struct entity *ent, position new_position) {
+    struct physics_engine_environment *env = ent->environment;
+    uint8_t i = ent->entity_idx;
     int32_t max_x_move, max_y_move;
     position displacement;
 
-    struct rectangle *rectangle = &ent->rectangle;
-    displacement = (position){new_position.x - rectangle->p1.x,
-                              new_position.y - rectangle->p1.y};
+    displacement =
+        (position){new_position.x - env->x1[i], new_position.y - env->y1[i]};
     if (displacement.x >= 0) {
-        max_x_move = ENVIRONMENT_MAX_X - rectangle->p2.x;
+        max_x_move = ENVIRONMENT_MAX_X - env->x2[i];
         if (displacement.x > max_x_move) {
-            rectangle->p1.x += max_x_move;
-            rectangle->p2.x += max_x_move;
+            env->x1[i] += max_x_move;
+            env->x2[i] += max_x_move;
         } else {
-            rectangle->p1.x += displacement.x;
-            rectangle->p2.x += displacement.x;
+            env->x1[i] += displacement.x;
+            env->x2[i] += displacement.x;
         }
     } else {
-        max_x_move = ENVIRONMENT_MIN_X - rectangle->p1.x;
+        max_x_move = ENVIRONMENT_MIN_X - env->x1[i];
         if (displacement.x < max_x_move) {
-            rectangle->p1.x += max_x_move;
-            rectangle->p2.x += max_x_move;
+            env->x1[i] += max_x_move;
+            env->x2[i] += max_x_move;
         } else {
-            rectangle->p1.x += displacement.x;
-            rectangle->p2.x += displacement.x;
+            env->x1[i] += displacement.x;
+            env->x2[i] += displacement.x;
         }
     }
 
     if (displacement.y >= 0) {
-        max_y_move = ENVIRONMENT_MAX_Y - rectangle->p2.y;
+        max_y_move = ENVIRONMENT_MAX_Y - env->y2[i];
         if (displacement.y > max_y_move) {
-            rectangle->p1.y += max_y_move;
-            rectangle->p2.y += max_y_move;
+            env->y1[i] += max_y_move;
+            env->y2[i] += max_y_move;
         } else {
-            rectangle->p1.y += displacement.y;
-            rectangle->p2.y += displacement.y;
+            env->y1[i] += displacement.y;
+            env->y2[i] += displacement.y;
         }
     } else {
-        max_y_move = ENVIRONMENT_MIN_Y - rectangle->p1.y;
+        max_y_move = ENVIRONMENT_MIN_Y - env->y1[i];
         if (displacement.y < max_y_move) {
-            rectangle->p1.y += max_y_move;
-            rectangle->p2.y += max_y_move;
+            env->y1[i] += max_y_move;
+            env->y2[i] += max_y_move;
         } else {
-            rectangle->p1.y += displacement.y;
-            rectangle->p2.y += displacement.y;
+            env->y1[i] += displacement.y;
+            env->y2[i] += displacement.y;
         }
     }
+
+    // Put where it is drawn too, rather than slid over from where it was
+    env->prev_x1[i] = env->x1[i];
+    env->prev_y1[i] = env->y1[i];
 }
 
 void set_entity_velocity(struct entity *ent, velocity new_velocity) {
-    ent->velocity = new_velocity;
+    ent->environment->vx[ent->entity_idx] = new_velocity.x;
+    ent->environment->vy[ent->entity_idx] = new_velocity.y;
 }
 
 void set_entity_acceleration(struct entity *ent, acceleration acceleration) {
-    ent->acceleration = acceleration;
+    ent->environment->ax[ent->entity_idx] = acceleration.x;
+    ent->environment->ay[ent->entity_idx] = acceleration.y;
 }
 
 void set_entity_position_relative(struct entity *ent,
@@ -98,21 +105,53 @@ void set_entity_acceleration_relative(struct entity *ent,
 }
 
 position get_entity_position(struct entity *ent) {
-    return ent->rectangle.p1;
+    return (position){ent->environment->x1[ent->entity_idx],
+                      ent->environment->y1[ent->entity_idx]};
+}
+
+position get_entity_render_position(struct entity *ent) {
+    const struct physics_engine_environment *env = ent->environment;
+    uint8_t i = ent->entity_idx;
+    int32_t lag = env->interpolation_lag;
+
+    if (lag == 0) {
+        return (position){env->x1[i], env->y1[i]};
+    }
+
+    return (position){
+        env->x1[i] - (((env->x1[i] - env->prev_x1[i]) * lag) >>
+                      PHYSICS_ENGINE_INTERPOLATION_BITS),
+        env->y1[i] - (((env->y1[i] - env->prev_y1[i]) * lag) >>
+                      PHYSICS_ENGINE_INTERPOLATION_BITS),
+    };
+}
+
+struct rectangle get_entity_rectangle(struct entity *ent) {
+    const struct physics_engine_environment *env = ent->environment;
+    uint8_t i = ent->entity_idx;
+
+    return (struct rectangle){{env->x1[i], env->y1[i]},
+                              {env->x2[i], env->y2[i]}};
 }
 
 velocity get_entity_velocity(struct entity *ent) {
-    return ent->velocity;
+    return (velocity){ent->environment->vx[ent->entity_idx],
+                      ent->environment->vy[ent->entity_idx]};
 }
 
 acceleration get_entity_acceleration(struct entity *ent) {
-    return ent->acceleration;
+    return (acceleration){ent->environment->ax[ent->entity_idx],
+                          ent->environment->ay[ent->entity_idx]};
 }
 
 void activate_entity(struct entity *ent) {
-    ent->active = true;
+    physics_engine_environment_activate(ent->environment, ent->entity_idx);
 }
 
 void deactivate_entity(struct entity *ent) {
-    ent->active = false;
+    physics_engine_environment_deactivate(ent->environment, ent->entity_idx);
+}
+
+bool entity_is_active(struct entity *ent) {
+    return physics_engine_mask_get(ent->environment->active, ent->entity_idx);
 }
@@ -9,8 +9,8 @@ void physics_engine_init(struct physics_engine *physics_engine) {
     random_number_generator_init(&context->random_number_generator);
 }
 
-void physics_engine_update(struct physics_engine *physics_engine,
-                           uint32_t delta_t) {
+uint32_t physics_engine_update(struct physics_engine *physics_engine,
+                               uint32_t delta_us) {
     struct physics_engine_context *context = &physics_engine->context;
     int ret = random_number_generator_update(&context->random_number_generator);
     if (ret != 0) {
@@ -18,9 +18,21 @@ void physics_engine_update(struct physics_engine *physics_engine,
                 ret);
     }
 
+    if (context->environment == NULL) {
+        return 0;
+    }
+
+    return physics_engine_environment_accumulate(context->environment,
+                                                 delta_us);
+}
+
+void physics_engine_step(struct physics_engine *physics_engine) {
+    struct physics_engine_context *context = &physics_engine->context;
+
     if (context->environment != NULL) {
         physics_engine_environment_update(context->event_queue,
-                                          context->environment, delta_t);
+                                          context->environment,
+                                          context->environment->tick_ms);
     }
 }
 
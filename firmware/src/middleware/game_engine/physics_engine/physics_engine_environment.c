@@ -1,5 +1,6 @@
 #include "physics_engine_environment.h"
 
+#include <errno.h>
 #include <stdbool.h>
 
 #include "environment.h"
@@ -7,171 +8,333 @@
 #include "physics_engine_events.h"
 #include "utils.h"
 
-static bool rectangles_overlap(const struct rectangle *r1,
-                               const struct rectangle *r2) {
-    return !(r1->p2.x < r2->p1.x ||  // r1 is to the left of r2
-             r1->p1.x > r2->p2.x ||  // r1 is to the right of r2
-             r1->p1.y > r2->p2.y ||  // r1 is below r2
-             r1->p2.y < r2->p1.y);   // r1 is above r2
+static inline bool entities_overlap(
+    const struct physics_engine_environment *env, uint32_t a, uint32_t b) {
+    return !(env->x2[a] < env->x1[b] ||  // a is to the left of b
+             env->x1[a] > env->x2[b] ||  // a is to the right of b
+             env->y1[a] > env->y2[b] ||  // a is below b
+             env->y2[a] < env->y1[b]);   // a is above b
 }
 
-static void update_rectangle_entity(struct ring_buffer *event_queue,
-                                    struct entity *ent, uint32_t delta_t) {
-    const velocity velocity = ent->velocity;
-    struct rectangle *rectangle = &ent->rectangle;
-    int32_t max_x_move, max_y_move;
-
-    if (velocity.x == 0) {
-        goto y_move;
-    }
-
-    int32_t x_displacement = velocity.x * delta_t;
-    if (velocity.x > 0) {
-        max_x_move = ENVIRONMENT_MAX_X - rectangle->p2.x;
-        if (x_displacement >= max_x_move) {
-            rectangle->p1.x += max_x_move;
-            rectangle->p2.x += max_x_move;
-
-            struct physics_engine_event event = {
-                .type = OUT_OF_BOUNDS_EVENT,
-                .out_of_bounds_event =
-                    {
-                        .type = OUT_OF_BOUNDS_RIGHT,
-                        .ent = ent,
-                    },
-            };
-            if (ring_buffer_push(event_queue, &event)) {
-                LOG_ERR(
-                    "Failed to add out of bounds (right) event to event queue: "
-                    "event queue full");
-            }
-        } else {
-            rectangle->p1.x += x_displacement;
-            rectangle->p2.x += x_displacement;
-        }
-    } else if (velocity.x < 0) {
-        max_x_move = ENVIRONMENT_MIN_X - rectangle->p1.x;
-        if (x_displacement <= max_x_move) {
-            rectangle->p1.x += max_x_move;
-            rectangle->p2.x += max_x_move;
-            struct physics_engine_event event = {
-                .type = OUT_OF_BOUNDS_EVENT,
-                .out_of_bounds_event =
-                    {
-                        .type = OUT_OF_BOUNDS_LEFT,
-                        .ent = ent,
-                    },
-            };
-            if (ring_buffer_push(event_queue, &event)) {
-                LOG_ERR(
-                    "Failed to add out of bounds (left) event to event queue: "
-                    "event queue full");
-            }
-        } else {
-            rectangle->p1.x += x_displacement;
-            rectangle->p2.x += x_displacement;
-        }
+/*
+ * Moves the edges p1 and p2 of an entity along one axis by the displacement
+ * its velocity makes, stopping at the bounds. Returns -1 if it was stopped
+ * at the lower bound, 1 if it was stopped at the upper bound, else 0.
+ */
+static inline int move_axis(int32_t *p1, int32_t *p2, int32_t velocity,
+                            int32_t displacement, int32_t min, int32_t max) {
+    int bound = 0;
+
+    if (velocity > 0 && displacement >= max - *p2) {
+        displacement = max - *p2;
+        bound = 1;
+    } else if (velocity < 0 && displacement <= min - *p1) {
+        displacement = min - *p1;
+        bound = -1;
     }
-y_move:
-    if (velocity.y == 0) {
-        return;
+
+    *p1 += displacement;
+    *p2 += displacement;
+
+    return bound;
+}
+
+static void push_out_of_bounds_event(
+    struct ring_buffer *event_queue, struct entity *ent,
+    enum physics_engine_out_of_bounds_type type) {
+    struct physics_engine_event event = {
+        .type = OUT_OF_BOUNDS_EVENT,
+        .out_of_bounds_event =
+            {
+                .type = type,
+                .ent = ent,
+            },
+    };
+
+    if (ring_buffer_push(event_queue, &event)) {
+        LOG_ERR(
+            "Failed to add out of bounds (%s) event to event queue: event "
+            "queue full",
+            physics_engine_out_of_bounds_type_to_str[type]);
     }
-    int32_t y_displacement = velocity.y * delta_t;
-    if (velocity.y > 0) {
-        max_y_move = ENVIRONMENT_MAX_Y - rectangle->p2.y;
-        if (y_displacement >= max_y_move) {
-            rectangle->p1.y += max_y_move;
-            rectangle->p2.y += max_y_move;
-            struct physics_engine_event event = {
-                .type = OUT_OF_BOUNDS_EVENT,
-                .out_of_bounds_event =
-                    {
-                        .type = OUT_OF_BOUNDS_BOTTOM,
-                        .ent = ent,
-                    },
-            };
-
-            if (ring_buffer_push(event_queue, &event)) {
-                LOG_ERR(
-                    "Failed to add out of bounds (bottom) event to event "
-                    "queue: event queue full");
-            }
-        } else {
-            rectangle->p1.y += y_displacement;
-            rectangle->p2.y += y_displacement;
+}
+
+static void push_collision_event(struct ring_buffer *event_queue,
+                                 struct physics_engine_environment *env,
+                                 uint32_t e1, uint32_t e2) {
+    struct entity *ent1 = &env->entities[e1];
+    struct entity *ent2 = &env->entities[e2];
+
+    LOG_DBG("Collision Occurred between: ent1=<%d> and ent2=<%d>",
+            ent1->entity_idx, ent2->entity_idx);
+    struct physics_engine_event event = {
+        .type = COLLISION_EVENT,
+        .collision_event =
+            {
+                .ent1 = ent1,
+                .ent2 = ent2,
+            },
+    };
+    if (ring_buffer_push(event_queue, &event)) {
+        LOG_ERR(
+            "Failed to add collision event to event queue: "
+            "event queue full");
+    }
+}
+
+/* Moves the active entities and applies their acceleration */
+static void integrate_entities(struct ring_buffer *event_queue,
+                               struct physics_engine_environment *env,
+                               uint32_t delta_t) {
+    int32_t *x1 = env->x1, *x2 = env->x2, *y1 = env->y1, *y2 = env->y2;
+    int32_t *vx = env->vx, *vy = env->vy;
+    const int32_t *ax = env->ax, *ay = env->ay;
+    const uint32_t *hit = env->hit;
+    bool any_hits = env->num_hits > 0;
+    const uint8_t *live = env->live;
+    uint32_t num_live = env->num_live;
+
+    for (uint32_t n = 0; n < num_live; n++) {
+        uint8_t i = live[n];
+
+        // The swept check has moved these already
+        if (any_hits && physics_engine_mask_get(hit, i)) {
+            continue;
         }
-    } else if (velocity.y < 0) {
-        max_y_move = ENVIRONMENT_MIN_Y - rectangle->p1.y;
-        if (y_displacement <= max_y_move) {
-            rectangle->p1.y += max_y_move;
-            rectangle->p2.y += max_y_move;
-            struct physics_engine_event event = {
-                .type = OUT_OF_BOUNDS_EVENT,
-                .out_of_bounds_event =
-                    {
-                        .type = OUT_OF_BOUNDS_TOP,
-                        .ent = ent,
-                    },
-            };
-            if (ring_buffer_push(event_queue, &event)) {
-                LOG_ERR(
-                    "Failed to add out of bounds (top) event to event queue: "
-                    "event queue full");
-            }
-        } else {
-            rectangle->p1.y += y_displacement;
-            rectangle->p2.y += y_displacement;
+
+        int bound = move_axis(&x1[i], &x2[i], vx[i], vx[i] * delta_t,
+                              ENVIRONMENT_MIN_X, ENVIRONMENT_MAX_X);
+        if (bound != 0) {
+            push_out_of_bounds_event(
+                event_queue, &env->entities[i],
+                bound > 0 ? OUT_OF_BOUNDS_RIGHT : OUT_OF_BOUNDS_LEFT);
+        }
+
+        bound = move_axis(&y1[i], &y2[i], vy[i], vy[i] * delta_t,
+                          ENVIRONMENT_MIN_Y, ENVIRONMENT_MAX_Y);
+        if (bound != 0) {
+            push_out_of_bounds_event(
+                event_queue, &env->entities[i],
+                bound > 0 ? OUT_OF_BOUNDS_BOTTOM : OUT_OF_BOUNDS_TOP);
         }
+
+        vx[i] += ax[i] * delta_t;
+        vy[i] += ay[i] * delta_t;
     }
 }
 
-static bool handle_collision(struct entity *e1, struct entity *e2) {
+/* Responds to a collision between two entities the broadphase found */
+static void handle_collision(struct physics_engine_environment *env,
+                             uint32_t e1, uint32_t e2) {
     // Simple elastic collision response by inverting velocities
     // For more accurate physics, we would need to calculate the collision
     // response based on mass, velocity, etc.
-    if (rectangles_overlap(&e1->rectangle, &e2->rectangle)) {
-        if (!e1->solid || !e2->solid) {
-            return true;
+    if (!physics_engine_mask_get(env->solid, e1) ||
+        !physics_engine_mask_get(env->solid, e2)) {
+        return;
+    }
+    int32_t *vx = env->vx, *vy = env->vy;
+    enum mass e1_mass = env->mass[e1], e2_mass = env->mass[e2];
+    int32_t mass_diff, mass_sum;
+    if (e1_mass != INFINITE_MASS && e2_mass != INFINITE_MASS) {
+        mass_diff = e1_mass - e2_mass;
+        mass_sum = e1_mass + e2_mass;
+
+        int32_t e1_vel_x = vx[e1];
+        int32_t e1_vel_y = vy[e1];
+
+        vx[e1] = ((mass_diff * vx[e1]) / mass_sum) +
+                 (((e2_mass << 1) * vx[e2]) / mass_sum);
+        vy[e1] = ((mass_diff * vy[e1]) / mass_sum) +
+                 (((e2_mass << 1) * vy[e2]) / mass_sum);
+
+        vx[e2] = (((e1_mass << 1) * e1_vel_x) / mass_sum) +
+                 ((-mass_diff * vx[e2]) / mass_sum);
+        vy[e2] = (((e1_mass << 1) * e1_vel_y) / mass_sum) +
+                 ((-mass_diff * vy[e2]) / mass_sum);
+    } else if (e1_mass == INFINITE_MASS && e2_mass != INFINITE_MASS) {
+        vx[e2] = (vx[e1]) - vx[e2];
+        vy[e2] = (vy[e1]) - vy[e2];
+
+    } else if (e1_mass != INFINITE_MASS && e2_mass == INFINITE_MASS) {
+        vx[e1] = (vx[e2]) - vx[e1];
+        vy[e1] = (vy[e2]) - vy[e1];
+    } else {
+        /* What happens if two object of infinite mass collide?
+        Maybe both of their velocities should just for to 0? */
+        vx[e1] = 0;
+        vy[e1] = 0;
+        vx[e2] = 0;
+        vy[e2] = 0;
+        /*vx[e1] = -vx[e1];
+        vy[e1] = -vy[e1];
+        vx[e2] = -vx[e2];
+        vy[e2] = -vy[e2];*/
+    }
+}
+
+/*
+ * Narrows [*entry, *exit] down to the times, in 1/2^PHYSICS_ENGINE_TOI_BITS
+ * ms, that the span a1 to a2 overlaps the span b1 to b2 while moving at
+ * velocity relative to it. Returns false if they do not overlap in it.
+ */
+static bool narrow_overlap_times(int32_t a1, int32_t a2, int32_t b1,
+                                 int32_t b2, int32_t velocity, int32_t *entry,
+                                 int32_t *exit) {
+    int32_t t_entry, t_exit;
+
+    if (velocity > 0) {
+        if (a1 > b2) {
+            return false;
+        }
+        // Rounded up, so the spans touch at the time of entry
+        t_entry = a2 < b1 ? (((b1 - a2) << PHYSICS_ENGINE_TOI_BITS) +
+                             velocity - 1) /
+                                velocity
+                          : 0;
+        t_exit = ((b2 - a1) << PHYSICS_ENGINE_TOI_BITS) / velocity;
+    } else if (velocity < 0) {
+        if (a2 < b1) {
+            return false;
+        }
+        t_entry = a1 > b2 ? (((a1 - b2) << PHYSICS_ENGINE_TOI_BITS) -
+                             velocity - 1) /
+                                -velocity
+                          : 0;
+        t_exit = ((a2 - b1) << PHYSICS_ENGINE_TOI_BITS) / -velocity;
+    } else {
+        return a2 >= b1 && a1 <= b2;
+    }
+
+    if (t_entry > *entry) {
+        *entry = t_entry;
+    }
+    if (t_exit < *exit) {
+        *exit = t_exit;
+    }
+
+    return *entry <= *exit;
+}
+
+/*
+ * Swept AABB test. Returns the time, in 1/2^PHYSICS_ENGINE_TOI_BITS ms,
+ * at which entity a moving at its velocity first overlaps entity b moving
+ * at its own, or -1 if that is later than limit. Entities that overlap
+ * already are left to the discrete check.
+ */
+static int32_t time_of_impact(const struct physics_engine_environment *env,
+                              uint32_t a, uint32_t b, int32_t limit) {
+    int32_t entry = 0;
+    int32_t exit = limit;
+
+    if (entities_overlap(env, a, b)) {
+        return -1;
+    }
+
+    if (!narrow_overlap_times(env->x1[a], env->x2[a], env->x1[b], env->x2[b],
+                              env->vx[a] - env->vx[b], &entry, &exit) ||
+        !narrow_overlap_times(env->y1[a], env->y2[a], env->y1[b], env->y2[b],
+                              env->vy[a] - env->vy[b], &entry, &exit)) {
+        return -1;
+    }
+
+    return entry;
+}
+
+/*
+ * Moves an entity on at its velocity for toi in 1/2^PHYSICS_ENGINE_TOI_BITS
+ * ms. Out of bounds events are only pushed if event_queue is given.
+ */
+static void move_entity(struct ring_buffer *event_queue,
+                        struct physics_engine_environment *env, uint32_t i,
+                        int32_t toi) {
+    int32_t dx = env->vx[i] * toi / (1 << PHYSICS_ENGINE_TOI_BITS);
+    int32_t dy = env->vy[i] * toi / (1 << PHYSICS_ENGINE_TOI_BITS);
+
+    int bound = move_axis(&env->x1[i], &env->x2[i], env->vx[i], dx,
+                          ENVIRONMENT_MIN_X, ENVIRONMENT_MAX_X);
+    if (bound != 0 && event_queue != NULL) {
+        push_out_of_bounds_event(
+            event_queue, &env->entities[i],
+            bound > 0 ? OUT_OF_BOUNDS_RIGHT : OUT_OF_BOUNDS_LEFT);
+    }
+
+    bound = move_axis(&env->y1[i], &env->y2[i], env->vy[i], dy,
+                      ENVIRONMENT_MIN_Y, ENVIRONMENT_MAX_Y);
+    if (bound != 0 && event_queue != NULL) {
+        push_out_of_bounds_event(
+            event_queue, &env->entities[i],
+            bound > 0 ? OUT_OF_BOUNDS_BOTTOM : OUT_OF_BOUNDS_TOP);
+    }
+}
+
+/*
+ * Continuous collision check of the swept entities, run before they move.
+ * A swept entity that would hit a solid entity during the update is moved
+ * to the point of contact, the collision is resolved there, and it moves on
+ * at its new velocity for the rest of the update. It is marked in hit, so
+ * the integrator and the discrete check leave it be.
+ */
+static void sweep_entities(struct ring_buffer *event_queue,
+                           struct physics_engine_environment *env,
+                           uint32_t delta_t) {
+    const uint8_t *live = env->live;
+    uint32_t num_live = env->num_live;
+    int32_t limit = delta_t << PHYSICS_ENGINE_TOI_BITS;
+
+    if (env->num_hits > 0) {
+        for (uint32_t w = 0;
+             w < PHYSICS_ENGINE_MASK_WORDS(env->num_of_entities); w++) {
+            env->hit[w] = 0;
+        }
+        env->num_hits = 0;
+    }
+
+    if (env->num_swept == 0) {
+        return;
+    }
+
+    for (uint32_t n = 0; n < num_live; n++) {
+        uint8_t a = live[n];
+        if (!physics_engine_mask_get(env->swept, a) ||
+            !physics_engine_mask_get(env->solid, a)) {
+            continue;
+        }
+
+        // The first contact, lowest index first on a tie
+        int32_t toi = -1;
+        uint8_t other = a;
+        for (uint32_t m = 0; m < num_live; m++) {
+            uint8_t b = live[m];
+            if (b == a || !physics_engine_mask_get(env->solid, b) ||
+                physics_engine_mask_get(env->hit, b)) {
+                continue;
+            }
+
+            int32_t t = time_of_impact(env, a, b, toi < 0 ? limit : toi);
+            if (t >= 0 && (toi < 0 || t < toi || (t == toi && b < other))) {
+                toi = t;
+                other = b;
+            }
         }
-        int32_t mass_diff, mass_sum;
-        if (e1->mass != INFINITE_MASS && e2->mass != INFINITE_MASS) {
-            mass_diff = e1->mass - e2->mass;
-            mass_sum = e1->mass + e2->mass;
-
-            int32_t e1_vel_x = e1->velocity.x;
-            int32_t e1_vel_y = e1->velocity.y;
-
-            e1->velocity.x = ((mass_diff * e1->velocity.x) / mass_sum) +
-                             (((e2->mass << 1) * e2->velocity.x) / mass_sum);
-            e1->velocity.y = ((mass_diff * e1->velocity.y) / mass_sum) +
-                             (((e2->mass << 1) * e2->velocity.y) / mass_sum);
-
-            e2->velocity.x = (((e1->mass << 1) * e1_vel_x) / mass_sum) +
-                             ((-mass_diff * e2->velocity.x) / mass_sum);
-            e2->velocity.y = (((e1->mass << 1) * e1_vel_y) / mass_sum) +
-                             ((-mass_diff * e2->velocity.y) / mass_sum);
-        } else if (e1->mass == INFINITE_MASS && e2->mass != INFINITE_MASS) {
-            e2->velocity.x = (e1->velocity.x) - e2->velocity.x;
-            e2->velocity.y = (e1->velocity.y) - e2->velocity.y;
-
-        } else if (e1->mass != INFINITE_MASS && e2->mass == INFINITE_MASS) {
-            e1->velocity.x = (e2->velocity.x) - e1->velocity.x;
-            e1->velocity.y = (e2->velocity.y) - e1->velocity.y;
-        } else {
-            /* What happens if two object of infinite mass collide?
-            Maybe both of their velocities should just for to 0? */
-            e1->velocity.x = 0;
-            e1->velocity.y = 0;
-            e2->velocity.x = 0;
-            e2->velocity.y = 0;
-            /*e1->velocity.x = -e1->velocity.x;
-            e1->velocity.y = -e1->velocity.y;
-            e2->velocity.x = -e2->velocity.x;
-            e2->velocity.y = -e2->velocity.y;*/
+
+        if (toi < 0) {
+            continue;
         }
-        return true;
+
+        uint8_t first = a < other ? a : other;
+        uint8_t second = a < other ? other : a;
+
+        move_entity(NULL, env, a, toi);
+        handle_collision(env, first, second);
+        push_collision_event(event_queue, env, first, second);
+        move_entity(event_queue, env, a, limit - toi);
+
+        env->vx[a] += env->ax[a] * delta_t;
+        env->vy[a] += env->ay[a] * delta_t;
+        physics_engine_mask_set(env->hit, a, true);
+        env->num_hits++;
     }
-    return false;
 }
 
 struct entity_creation_result add_entity(
@@ -194,34 +357,47 @@ struct entity_creation_result add_entity(
     }
 
     /* Ensure that the maximum entity count is not exceeded */
-    if (env->num_of_entities >= MAX_ENTITIES) {
+    if (env->num_of_entities >= env->max_entities) {
         result.error = ENTITY_CREATION_TOO_MANY_ENTITIES;
         return result;
     }
 
     /* Grab the next available entity slot */
-    struct entity *new_entity = &env->entities[env->num_of_entities];
+    uint32_t i = env->num_of_entities;
+    struct entity *new_entity = &env->entities[i];
 
     /* Set entity position */
-    new_entity->rectangle = init_struct->rectangle;
+    env->x1[i] = init_struct->rectangle.p1.x;
+    env->y1[i] = init_struct->rectangle.p1.y;
+    env->x2[i] = init_struct->rectangle.p2.x;
+    env->y2[i] = init_struct->rectangle.p2.y;
+    env->prev_x1[i] = env->x1[i];
+    env->prev_y1[i] = env->y1[i];
 
     /* Set entity mass */
-    new_entity->mass = init_struct->mass;
+    env->mass[i] = init_struct->mass;
 
     /* Set entity velocity */
-    new_entity->velocity = init_struct->velocity;
+    env->vx[i] = init_struct->velocity.x;
+    env->vy[i] = init_struct->velocity.y;
 
     /* Set entity acceleration */
-    new_entity->acceleration = init_struct->acceleration;
-
-    /* Set entity solid flag */
-    new_entity->solid = init_struct->solid;
+    env->ax[i] = init_struct->acceleration.x;
+    env->ay[i] = init_struct->acceleration.y;
+
+    /* Set entity solid and swept flags */
+    physics_engine_mask_set(env->solid, i, init_struct->solid);
+    physics_engine_mask_set(env->swept, i, init_struct->swept);
+    if (init_struct->solid && init_struct->swept) {
+        env->num_swept++;
+    }
 
     /* Initialize entity as inactive */
-    new_entity->active = false;
+    physics_engine_mask_set(env->active, i, false);
 
     /* Set and increment entity idx */
-    new_entity->entity_idx = env->num_of_entities;
+    new_entity->environment = env;
+    new_entity->entity_idx = i;
     env->num_of_entities += 1;
 
     /* Place initialized entity pointer in result */
@@ -230,6 +406,205 @@ struct entity_creation_result add_entity(
     return result;
 }
 
+/* The pool the entity at idx is in, or NULL if it is in none */
+static struct physics_engine_pool *find_pool(
+    struct physics_engine_environment *env, uint32_t idx) {
+    for (uint32_t p = 0; p < env->num_pools; p++) {
+        struct physics_engine_pool *pool = &env->pools[p];
+        if (idx >= pool->first && idx < pool->first + pool->n) {
+            return pool;
+        }
+    }
+
+    return NULL;
+}
+
+/* Swaps two places in the pool order, keeping the pool slots in step */
+static void swap_pool_order(struct physics_engine_environment *env,
+                            uint32_t a, uint32_t b) {
+    uint8_t ent_a = env->pool_order[a];
+    uint8_t ent_b = env->pool_order[b];
+
+    env->pool_order[a] = ent_b;
+    env->pool_slot[ent_b] = a;
+    env->pool_order[b] = ent_a;
+    env->pool_slot[ent_a] = b;
+}
+
+int physics_engine_environment_add_pool(struct physics_engine_environment *env,
+                                        uint32_t first, uint32_t n) {
+    // The pool keeps its bounds in a byte
+    if (n == 0 || first + n > env->num_of_entities || first + n > UINT8_MAX) {
+        return -EINVAL;
+    }
+
+    for (uint32_t i = first; i < first + n; i++) {
+        if (find_pool(env, i) != NULL) {
+            return -EINVAL;
+        }
+    }
+
+    if (env->num_pools >= PHYSICS_ENGINE_MAX_POOLS) {
+        return -ENOSPC;
+    }
+
+    struct physics_engine_pool *pool = &env->pools[env->num_pools];
+    *pool = (struct physics_engine_pool){.first = first, .n = n};
+
+    for (uint32_t i = first; i < first + n; i++) {
+        env->pool_order[i] = i;
+        env->pool_slot[i] = i;
+    }
+
+    // Entities activated before the pool was made go to the front
+    for (uint32_t i = first; i < first + n; i++) {
+        if (physics_engine_mask_get(env->active, i)) {
+            swap_pool_order(env, env->pool_slot[i],
+                            pool->first + pool->n_active);
+            pool->n_active++;
+        }
+    }
+
+    return env->num_pools++;
+}
+
+struct entity *physics_engine_environment_get_free_entity(
+    struct physics_engine_environment *env, uint32_t pool) {
+    if (pool >= env->num_pools) {
+        return NULL;
+    }
+
+    struct physics_engine_pool *p = &env->pools[pool];
+    if (p->n_active == p->n) {
+        return NULL;
+    }
+
+    return &env->entities[env->pool_order[p->first + p->n_active]];
+}
+
+void physics_engine_environment_activate(
+    struct physics_engine_environment *env, uint32_t idx) {
+    if (physics_engine_mask_get(env->active, idx)) {
+        return;
+    }
+
+    physics_engine_mask_set(env->active, idx, true);
+
+    // Appended out of order, the next update sorts it into place
+    env->live_slot[idx] = env->num_live;
+    env->live[env->num_live++] = idx;
+
+    struct physics_engine_pool *pool = find_pool(env, idx);
+    if (pool != NULL) {
+        swap_pool_order(env, env->pool_slot[idx],
+                        pool->first + pool->n_active);
+        pool->n_active++;
+    }
+}
+
+void physics_engine_environment_deactivate(
+    struct physics_engine_environment *env, uint32_t idx) {
+    if (!physics_engine_mask_get(env->active, idx)) {
+        return;
+    }
+
+    physics_engine_mask_set(env->active, idx, false);
+
+    // The last live entity takes its place, the next update re-sorts it
+    uint8_t last = env->live[--env->num_live];
+    env->live[env->live_slot[idx]] = last;
+    env->live_slot[last] = env->live_slot[idx];
+
+    struct physics_engine_pool *pool = find_pool(env, idx);
+    if (pool != NULL) {
+        pool->n_active--;
+        swap_pool_order(env, env->pool_slot[idx],
+                        pool->first + pool->n_active);
+    }
+}
+
+/*
+ * Insertion sorts the live list by left edge, then by index. Entities move
+ * a fraction of a cell per update, so the order from the last update is
+ * nearly sorted and this is close to linear.
+ *
+ * Ordering ties by index matters for clumps, where entities share a left
+ * edge: the sweep then meets each entity's candidates in index order, so
+ * its lowest overlap comes first and the rest are skipped without a test,
+ * as the all pairs loop did when it stopped at an entity's first overlap.
+ */
+static void sort_sweep_order(struct physics_engine_environment *env) {
+    const int32_t *x1 = env->x1;
+    uint8_t *live = env->live;
+    uint8_t *live_slot = env->live_slot;
+
+    for (uint32_t i = 1; i < env->num_live; i++) {
+        uint8_t idx = live[i];
+        int32_t x = x1[idx];
+        uint32_t j = i;
+
+        while (j > 0 && (x1[live[j - 1]] > x ||
+                         (x1[live[j - 1]] == x && live[j - 1] > idx))) {
+            live[j] = live[j - 1];
+            live_slot[live[j]] = j;
+            j--;
+        }
+        live[j] = idx;
+        live_slot[idx] = j;
+    }
+}
+
+/*
+ * Sort-and-sweep broadphase over the live list. An entity is only tested
+ * against the entities after it whose left edge is not past its right
+ * edge, the others cannot overlap it. Each entity set in colliding is left
+ * with the lowest index entity after it that it overlaps, which is the one
+ * the collision check resolves, as an entity takes part in one collision
+ * per update as the first of the pair.
+ */
+static void find_contacts(struct physics_engine_environment *env) {
+    const int32_t *x1 = env->x1, *x2 = env->x2;
+    const uint8_t *live = env->live;
+    uint32_t *colliding = env->colliding;
+    uint8_t *contacts = env->contacts;
+    uint32_t num_live = env->num_live;
+    uint32_t n_pair_tests = 0;
+
+    for (uint32_t w = 0; w < PHYSICS_ENGINE_MASK_WORDS(env->num_of_entities);
+         w++) {
+        colliding[w] = 0;
+    }
+
+    sort_sweep_order(env);
+
+    for (uint32_t s = 0; s < num_live; s++) {
+        uint8_t a = live[s];
+
+        for (uint32_t t = s + 1; t < num_live; t++) {
+            uint8_t b = live[t];
+            if (x1[b] > x2[a]) {
+                break;
+            }
+
+            // Skip pairs that cannot beat the contact already found
+            uint8_t first = a < b ? a : b;
+            uint8_t second = a < b ? b : a;
+            if (physics_engine_mask_get(colliding, first) &&
+                contacts[first] < second) {
+                continue;
+            }
+
+            n_pair_tests++;
+            if (entities_overlap(env, a, b)) {
+                contacts[first] = second;
+                physics_engine_mask_set(colliding, first, true);
+            }
+        }
+    }
+
+    env->n_pair_tests += n_pair_tests;
+}
+
 static inline int sign(int x) {
     return (x > 0) - (x < 0);
 }
@@ -237,69 +612,79 @@ static inline int sign(int x) {
 void physics_engine_environment_update(struct ring_buffer *event_queue,
                                        struct physics_engine_environment *env,
                                        uint32_t delta_t) {
+    // Kept while paused too, so the entities are drawn standing still
+    for (uint32_t n = 0; n < env->num_live; n++) {
+        uint8_t i = env->live[n];
+        env->prev_x1[i] = env->x1[i];
+        env->prev_y1[i] = env->y1[i];
+    }
+
     if (env->paused) {
         return;
     }
 
-    uint32_t t0_1 = TIM21->CNT;
+    // Move the swept entities that collide on the way
+    sweep_entities(event_queue, env, delta_t);
 
     // Update positions
-    for (int i = 0; i < env->num_of_entities; i++) {
-        struct entity *ent = &env->entities[i];
-        if (ent->active) {
-            update_rectangle_entity(event_queue, ent, delta_t);
+    integrate_entities(event_queue, env, delta_t);
 
-            if (ent->acceleration.x != 0) {
-                ent->velocity.x += ent->acceleration.x * delta_t;
-            }
-            if (ent->acceleration.y != 0) {
-                ent->velocity.y += ent->acceleration.y * delta_t;
+    // Check for collisions
+    find_contacts(env);
+
+    // Resolved in index order, walking the set bits of each colliding word
+    for (uint32_t w = 0; w < PHYSICS_ENGINE_MASK_WORDS(env->num_of_entities);
+         w++) {
+        uint32_t bits = env->colliding[w];
+
+        while (bits != 0) {
+            uint32_t i = w * 32U + __builtin_ctz(bits);
+            uint8_t j = env->contacts[i];
+            bits &= bits - 1U;
+
+            // Left to the swept check if either was resolved by it
+            if (env->num_hits > 0 && (physics_engine_mask_get(env->hit, i) ||
+                                      physics_engine_mask_get(env->hit, j))) {
+                continue;
             }
+
+            handle_collision(env, i, j);
+            push_collision_event(event_queue, env, i, j);
         }
     }
+}
 
-    uint32_t t1 = TIM21->CNT;
+uint32_t physics_engine_environment_accumulate(
+    struct physics_engine_environment *env, uint32_t delta_us) {
+    uint32_t tick_us = env->tick_ms * 1000U;
 
-    // Check for collisions
-    for (int i = 0; i < env->num_of_entities; i++) {
-        struct entity *ent1 = &env->entities[i];
-        if (ent1->active) {
-            velocity initial_velocity = ent1->velocity;
-            uint8_t num_collisions = 0;
-            for (int j = i + 1; j < env->num_of_entities; j++) {
-                struct entity *ent2 = &env->entities[j];
-                /* TODO: Necessary?? */
-                if (ent1->active && ent2->active) {
-                    /* TODO: Event Queue?? */
-                    if (handle_collision(ent1, ent2)) {
-                        LOG_DBG(
-                            "Collision Occurred between: ent1=<%d> and "
-                            "ent2=<%d>",
-                            ent1->entity_idx, ent2->entity_idx);
-                        struct physics_engine_event event = {
-                            .type = COLLISION_EVENT,
-                            .collision_event =
-                                {
-                                    .ent1 = ent1,
-                                    .ent2 = ent2,
-                                },
-                        };
-                        if (ring_buffer_push(event_queue, &event)) {
-                            LOG_ERR(
-                                "Failed to add collision event to event queue: "
-                                "event queue full");
-                        }
-                        num_collisions++;
-                        break;
-                    }
-                }
-            }
-        }
+    env->accumulator_us += delta_us;
+
+    // Steps past max_steps are dropped along with their time
+    uint32_t n_steps = env->accumulator_us / tick_us;
+    if (n_steps > env->max_steps) {
+        n_steps = env->max_steps;
     }
+    env->accumulator_us %= tick_us;
+
+    // Drawn a step behind, the time carried over is how far into it
+    env->interpolation_lag =
+        ((tick_us - env->accumulator_us) << PHYSICS_ENGINE_INTERPOLATION_BITS) /
+        tick_us;
 
-    uint32_t t2 = TIM21->CNT;
-    uint32_t duration1 = t1 - t0_1;
-    uint32_t duration2 = t2 - t1;
+    return n_steps;
+}
+
+int physics_engine_environment_set_tick(struct physics_engine_environment *env,
+                                        uint32_t tick_ms) {
+    if (tick_ms == 0) {
+        return -EINVAL;
+    }
+
+    env->tick_ms = tick_ms;
+    env->accumulator_us = 0;
+
+    return 0;
 }
 
 void print_physics_engine_environment(
@@ -309,17 +694,13 @@ void print_physics_engine_environment(
     LOG_INF("\tEntities:");
 
     for (int i = 0; i < env->num_of_entities; i++) {
-        struct entity ent = env->entities[i];
-
         LOG_INF("\t\tEntity %u:", i);
-        LOG_INF("\t\t\tPosition 1: (%d, %d)", ent.rectangle.p1.x,
-                ent.rectangle.p1.y);
-        LOG_INF("\t\t\tPosition 2: (%d, %d)", ent.rectangle.p2.x,
-                ent.rectangle.p2.y);
-        LOG_INF("\t\t\tVelocity: (%d, %d)", ent.velocity.x, ent.velocity.y);
-        LOG_INF("\t\t\tSolid: %u", ent.solid);
-        LOG_INF("\t\t\tValid: %u", ent.active);
-        LOG_INF("\t\t\tIdx: %u", ent.entity_idx);
+        LOG_INF("\t\t\tPosition 1: (%d, %d)", env->x1[i], env->y1[i]);
+        LOG_INF("\t\t\tPosition 2: (%d, %d)", env->x2[i], env->y2[i]);
+        LOG_INF("\t\t\tVelocity: (%d, %d)", env->vx[i], env->vy[i]);
+        LOG_INF("\t\t\tSolid: %u", physics_engine_mask_get(env->solid, i));
+        LOG_INF("\t\t\tValid: %u", physics_engine_mask_get(env->active, i));
+        LOG_INF("\t\t\tIdx: %u", env->entities[i].entity_idx);
     }
 }
 
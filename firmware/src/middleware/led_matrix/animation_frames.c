@@ -15,13 +15,19 @@ volatile struct led_matrix runtime_animation[1] = {
 
 // This is where we map animations to the arrays that represent them
 volatile struct led_matrix *animation_map_values[3] = {
-    [ANIM_TEST_ANIMATION] = test_animation,
+    [ANIM_TEST_ANIMATION] = NULL,
     [ANIM_SAVED_ANIMATION] = saved_animation,
     [ANIM_RUNTIME_ANIMATION] = runtime_animation};
 
+// Generated animations are packed and decoded by the loader
+const struct packed_animation *animation_map_packed[3] = {
+    [ANIM_TEST_ANIMATION] = &test_animation,
+    [ANIM_SAVED_ANIMATION] = NULL,
+    [ANIM_RUNTIME_ANIMATION] = NULL};
+
 // And map the lengths of the animations
 uint32_t animation_map_lens[3] = {
-    [ANIM_TEST_ANIMATION] = sizeof(test_animation) / sizeof(struct led_matrix),
+    [ANIM_TEST_ANIMATION] = test_animation.n_frames,
     [ANIM_SAVED_ANIMATION] =
         sizeof(saved_animation) / sizeof(struct led_matrix),
     [ANIM_RUNTIME_ANIMATION] =
@@ -0,0 +1,115 @@
+#include "display_brightness.h"
+
+#include "charlieplex_driver.h"
+#include "display_luts.h"
+#include "logging.h"
+#include "system_communication.h"
+
+extern struct driver_comm_message_passing ambient_light_comm;
+
+struct display_brightness_context {
+    bool enabled;
+    bool primed;            // The filter has been seeded with a reading
+    uint32_t lux_filtered;  // Smoothed lux, scaled by 1 << FILTER_SHIFT
+    int index;              // Bucket the display is following
+    uint32_t duty;
+    uint32_t refresh_rate;
+};
+
+static struct display_brightness_context context = {
+    .enabled = true,
+    .duty = CHARLIEPLEX_DUTY_FULL,
+    .refresh_rate = CHARLIEPLEX_REFRESH_RATE,
+};
+
+/* Quarter octave bucket of `lux`, matching scripts/lut_generator.c */
+static int display_brightness_lux_index(uint32_t lux) {
+    uint32_t value = lux + 1U;
+    int msb = 0;
+
+    while (value >> (msb + 1)) {
+        msb++;
+    }
+
+    uint32_t frac =
+        msb >= 2 ? (value >> (msb - 2)) & 3U : (value << (2 - msb)) & 3U;
+    int index = 4 * msb + frac;
+
+    return index < DISPLAY_LUT_SIZE ? index : DISPLAY_LUT_SIZE - 1;
+}
+
+static void display_brightness_apply(uint32_t duty, uint32_t refresh_rate) {
+    if (duty == context.duty && refresh_rate == context.refresh_rate) {
+        return;
+    }
+
+    if (charlieplex_driver_set_timing(refresh_rate, duty) < 0) {
+        LOG_ERR("Display timing out of range: %lu Hz, duty %lu",
+                refresh_rate, duty);
+        return;
+    }
+
+    context.duty = duty;
+    context.refresh_rate = refresh_rate;
+}
+
+void display_brightness_enable(bool enable) {
+    context.enabled = enable;
+    context.primed = false;
+
+    if (!enable) {
+        display_brightness_apply(CHARLIEPLEX_DUTY_FULL,
+                                 CHARLIEPLEX_REFRESH_RATE);
+    }
+}
+
+void display_brightness_get(uint32_t *duty, uint32_t *refresh_rate) {
+    *duty = context.duty;
+    *refresh_rate = context.refresh_rate;
+}
+
+void display_brightness_run(void) {
+    /*
+     * Until the sensor has delivered its first reading the als is only a
+     * placeholder, so stay at full duty rather than seed the filter with it.
+     */
+    if (!context.enabled || !ambient_light_comm.data.ambient_light.valid) {
+        return;
+    }
+
+    uint32_t lux = ambient_light_comm.data.ambient_light.als;
+
+    // Exponential moving average, seeded with the first reading
+    if (!context.primed) {
+        context.lux_filtered = lux << DISPLAY_BRIGHTNESS_FILTER_SHIFT;
+        context.index = display_brightness_lux_index(lux);
+        context.primed = true;
+    } else {
+        context.lux_filtered +=
+            lux - (context.lux_filtered >> DISPLAY_BRIGHTNESS_FILTER_SHIFT);
+    }
+
+    int index = display_brightness_lux_index(context.lux_filtered >>
+                                             DISPLAY_BRIGHTNESS_FILTER_SHIFT);
+    if (index > context.index + DISPLAY_BRIGHTNESS_HYSTERESIS ||
+        index < context.index - DISPLAY_BRIGHTNESS_HYSTERESIS) {
+        context.index = index;
+    }
+
+    // Step the duty towards the target so the change fades in
+    uint32_t target = display_duty_lut[context.index];
+    uint32_t duty = context.duty;
+    if (target > duty + DISPLAY_BRIGHTNESS_STEP) {
+        duty += DISPLAY_BRIGHTNESS_STEP;
+    } else if (target + DISPLAY_BRIGHTNESS_STEP < duty) {
+        duty -= DISPLAY_BRIGHTNESS_STEP;
+    } else {
+        duty = target;
+    }
+
+    // The rate table is out of 255 like the duty
+    uint32_t refresh_rate =
+        CHARLIEPLEX_REFRESH_RATE * display_rate_lut[context.index] / 255U;
+
+    display_brightness_apply(duty, refresh_rate);
+}
@@ -0,0 +1,163 @@
+#include "display_telemetry.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "charlieplex_driver.h"
+#include "job_queue.h"
+#include "led_matrix.h"
+#include "stm32l0xx_hal.h"
+#include "uart_logger.h"
+
+struct display_telemetry_context {
+    uint32_t update_stamp;   // Time of the last game update
+    bool update_pending;     // A game update has not been rendered yet
+    uint32_t slot_stamp[LED_MATRIX_BUFFER_SIZE];
+
+    uint32_t latencies[DISPLAY_TELEMETRY_N_LATENCIES];  // In cycles
+    uint32_t n_latencies;  // Total recorded, the ring holds the last few
+
+    uint32_t window_start;  // HAL tick the current fps window started
+    uint32_t window_shown;  // Frames shown when the window started
+    uint32_t fps_x10;
+
+    int dump_line;  // Next line of the dump, or -1 if not dumping
+};
+
+static struct display_telemetry_context context = {
+    .dump_line = -1,
+};
+
+void display_telemetry_mark_update(void) {
+    context.update_stamp = job_queue_timestamp();
+    context.update_pending = true;
+}
+
+uint32_t display_telemetry_frame_rendered(void) {
+    if (!context.update_pending) {
+        return job_queue_timestamp();
+    }
+
+    context.update_pending = false;
+    return context.update_stamp;
+}
+
+void display_telemetry_frame_committed(uint32_t slot, uint32_t stamp) {
+    context.slot_stamp[slot] = stamp;
+}
+
+void display_telemetry_frame_drawn(uint32_t slot) {
+    uint32_t latency = job_queue_timestamp() - context.slot_stamp[slot];
+
+    context.latencies[context.n_latencies % DISPLAY_TELEMETRY_N_LATENCIES] =
+        latency;
+    context.n_latencies++;
+}
+
+static uint32_t cycles_to_us(uint32_t cycles) {
+    return (uint64_t)cycles * 1000000U / SystemCoreClock;
+}
+
+void display_telemetry_get(struct display_telemetry *telemetry) {
+    struct charlieplex_driver_stats driver_stats;
+    struct led_matrix_frame_stats frame_stats;
+    uint32_t sorted[DISPLAY_TELEMETRY_N_LATENCIES];
+    size_t n = context.n_latencies < DISPLAY_TELEMETRY_N_LATENCIES
+                   ? context.n_latencies
+                   : DISPLAY_TELEMETRY_N_LATENCIES;
+
+    charlieplex_driver_get_stats(&driver_stats);
+    led_matrix_get_frame_stats(&frame_stats);
+
+    // Insertion sort, the window is small and this only runs on request
+    memcpy(sorted, context.latencies, n * sizeof(sorted[0]));
+    for (size_t i = 1; i < n; i++) {
+        uint32_t value = sorted[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    *telemetry = (struct display_telemetry){
+        .fps_x10 = context.fps_x10,
+        .latency_p50_us = n ? cycles_to_us(sorted[n / 2]) : 0,
+        .latency_p99_us = n ? cycles_to_us(sorted[(n * 99) / 100]) : 0,
+        .n_shown = driver_stats.n_shown,
+        .n_dropped = driver_stats.n_dropped,
+        .n_repeats = driver_stats.n_repeats,
+        .n_underruns = frame_stats.n_underruns,
+        .n_skipped = frame_stats.n_skipped,
+    };
+}
+
+void display_telemetry_dump(void) {
+    if (context.dump_line < 0) {
+        context.dump_line = 0;
+    }
+}
+
+static bool display_telemetry_window_elapsed(void) {
+    return HAL_GetTick() - context.window_start >= DISPLAY_TELEMETRY_WINDOW_MS;
+}
+
+/* Ready to close the fps window, or to print once the uart has drained */
+bool display_telemetry_is_ready(void) {
+    return display_telemetry_window_elapsed() ||
+           (context.dump_line >= 0 && uart_logger_is_idle());
+}
+
+static void display_telemetry_sample_fps(void) {
+    struct charlieplex_driver_stats driver_stats;
+    uint32_t now = HAL_GetTick();
+    uint32_t elapsed = now - context.window_start;
+
+    charlieplex_driver_get_stats(&driver_stats);
+
+    context.fps_x10 =
+        (driver_stats.n_shown - context.window_shown) * 10000U / elapsed;
+    context.window_start = now;
+    context.window_shown = driver_stats.n_shown;
+}
+
+/* Closes the fps window when due, and prints one line of a dump per call */
+void display_telemetry_run(void) {
+    struct display_telemetry telemetry;
+
+    if (display_telemetry_window_elapsed()) {
+        display_telemetry_sample_fps();
+    }
+
+    if (context.dump_line < 0 || !uart_logger_is_idle()) {
+        return;
+    }
+
+    display_telemetry_get(&telemetry);
+
+    switch (context.dump_line) {
+        case 0:
+            uart_logger_send("display: fps %lu.%lu shown %lu\r\n",
+                             telemetry.fps_x10 / 10, telemetry.fps_x10 % 10,
+                             telemetry.n_shown);
+            break;
+        case 1:
+            uart_logger_send("display: latency p50 %luus p99 %luus\r\n",
+                             telemetry.latency_p50_us,
+                             telemetry.latency_p99_us);
+            break;
+        case 2:
+            uart_logger_send(
+                "display: dropped %lu repeats %lu underruns %lu skipped "
+                "%lu\r\n",
+                telemetry.n_dropped, telemetry.n_repeats,
+                telemetry.n_underruns, telemetry.n_skipped);
+            break;
+        default:
+            context.dump_line = -1;
+            return;
+    }
+
+    context.dump_line++;
+}
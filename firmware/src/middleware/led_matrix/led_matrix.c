@@ -1,37 +1,99 @@
 #include "led_matrix.h"
 
+#include <errno.h>
 #include <stdbool.h>
 
 #include "animation_frames.h"
 #include "charlieplex_driver.h"
+#include "display_telemetry.h"
+#include "job_queue.h"
 #include "logging.h"
+#include "scroll_text.h"
 #include "sprite.h"
 #include "sprite_maps.h"
 #include "string.h"
 #include "system_communication.h"
+#include "utils.h"
 
 volatile bool update_requested;
 
-/* Type to represent the led matrix thats usable for the charlieplex code */
-struct matrix_instance {
-    uint8_t matrix[NUM_LEDS];
+/* A frame in the bit-plane format the charlieplex driver draws from */
+struct frame_instance {
+    struct charlieplex_planes planes;
 };
 
-/* Container of matrix_instances to make a single frame */
-struct frame_instance {
-    struct matrix_instance frame;
+/* Assembled frames are double buffered, the driver copies them on draw */
+#define N_FRAME_INSTANCES 2
+
+/*
+ * Free running frame counts, the slot is the count modulo the ring size.
+ * Only the producer moves `head` and only the consumer moves `tail`.
+ */
+struct led_matrix_ring {
+    volatile uint32_t head;  // Frames committed
+    volatile uint32_t tail;  // Frames released
+};
+
+/*
+ * `submitted` is set whenever the layer's source hands over a frame, changed
+ * or not, and holds the source back until the compositor has taken it. This
+ * keeps the sources paced by the display. `dirty` is only set when the
+ * contents changed, and decides whether the layers need blending again.
+ * `stamp` is when the source produced the frame, in job queue cycles, which
+ * display telemetry measures the frame's latency from.
+ */
+struct led_matrix_layer {
+    struct led_matrix cache;  // Last contents from the layer's source
+    enum led_matrix_blend blend;
+    uint8_t opacity;
+    bool enabled;
+    bool submitted;  // A frame was handed over since the last composition
+    bool dirty;      // The contents changed since the last composition
+    uint32_t stamp;  // When the last frame was handed over
 };
 
 struct led_matrix_context {
+    struct led_matrix_layer layers[N_LED_MATRIX_LAYERS];
+    struct led_matrix render_scratch;  // Renderer's frame while in progress
+    struct led_matrix composed;        // Last frame the compositor blended
+    uint32_t composed_hash;
+    uint32_t composed_mask;  // Layers that were enabled for `composed`
+    bool composed_valid;     // False until the first frame is composed
+
     struct led_matrix matrix_buff[LED_MATRIX_BUFFER_SIZE];
-    struct frame_instance frame_buff[LED_MATRIX_BUFFER_SIZE];
+    uint32_t matrix_hash[LED_MATRIX_BUFFER_SIZE];  // Hash of each finished slot
+    struct led_matrix_ring ring;
+    bool starved;  // The assembler is waiting on an empty ring
+
+    struct frame_instance frame_buff[N_FRAME_INSTANCES];
     struct driver_comm_shared_memory *comm;
+
+    uint32_t displayed_hash;  // Hash of the frame the driver is showing
+    bool displayed_valid;     // False until the first frame is drawn
+    struct led_matrix_frame_stats frame_stats;
+
+    struct packed_animation_cursor cursor;  // Loader's place in a packed anim
 };
 
 extern struct driver_comm_shared_memory led_matrix_comm;
 
-static struct led_matrix_context led_matrix_context = {.comm =
-                                                           &led_matrix_comm};
+static struct led_matrix_context led_matrix_context = {
+    .layers =
+        {
+            [LED_MATRIX_LAYER_ANIMATION] = {.blend = LED_MATRIX_BLEND_REPLACE,
+                                            .opacity =
+                                                LED_MATRIX_OPACITY_OPAQUE,
+                                            .enabled = true},
+            [LED_MATRIX_LAYER_SPRITES] = {.blend = LED_MATRIX_BLEND_ADD,
+                                          .opacity = LED_MATRIX_OPACITY_OPAQUE,
+                                          .enabled = true},
+            // Only turned on while text is scrolling
+            [LED_MATRIX_LAYER_TEXT] = {.blend = LED_MATRIX_BLEND_REPLACE,
+                                       .opacity = LED_MATRIX_OPACITY_OPAQUE,
+                                       .enabled = false},
+        },
+    .comm = &led_matrix_comm,
+};
 
 /*
  * Helper functions to get the entry from an index
@@ -45,6 +107,59 @@ struct frame_instance *get_frame_entry(struct led_matrix_context *context,
     return &context->frame_buff[num];
 }
 
+/* FNV-1a over the whole matrix, cheap enough to run once per frame */
+static uint32_t led_matrix_hash(const struct led_matrix *matrix) {
+    const uint8_t *data = &matrix->mat[0][0];
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < sizeof(matrix->mat); i++) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+
+    return hash;
+}
+
+static uint32_t led_matrix_ring_occupancy(struct led_matrix_context *context) {
+    return context->ring.head - context->ring.tail;
+}
+
+/*
+ * Returns the slot the producer should write its next frame to, or -ENOBUFS
+ * if the ring is full. The slot is not published until it is committed, so
+ * acquiring again before then returns the same slot.
+ */
+static int led_matrix_ring_acquire(struct led_matrix_context *context) {
+    if (led_matrix_ring_occupancy(context) >= LED_MATRIX_BUFFER_SIZE) {
+        return -ENOBUFS;
+    }
+
+    return context->ring.head % LED_MATRIX_BUFFER_SIZE;
+}
+
+/* Publishes the acquired slot to the consumer */
+static void led_matrix_ring_commit(struct led_matrix_context *context) {
+    context->ring.head++;
+
+    uint32_t occupancy = led_matrix_ring_occupancy(context);
+    if (occupancy > context->frame_stats.max_occupancy) {
+        context->frame_stats.max_occupancy = occupancy;
+    }
+}
+
+/* Returns the oldest committed slot, or -EAGAIN if the ring is empty */
+static int led_matrix_ring_peek(struct led_matrix_context *context) {
+    if (led_matrix_ring_occupancy(context) == 0) {
+        return -EAGAIN;
+    }
+
+    return context->ring.tail % LED_MATRIX_BUFFER_SIZE;
+}
+
+/* Hands the peeked slot back to the producer */
+static void led_matrix_ring_release(struct led_matrix_context *context) {
+    context->ring.tail++;
+}
+
 uint32_t get_anim_length(enum animation_map anim) {
     return animation_map_lens[anim];
 }
@@ -53,65 +168,151 @@ void led_matrix_setup(void) {
     charlieplex_driver_init();
 }
 
-void led_matrix_loader_run(void) {
-    struct led_matrix_context *context = &led_matrix_context;
-    struct driver_comm_shared_memory *comm = context->comm;
+/* Rounded x / 255 for x up to 255 * 255, the M0+ has no hardware divide */
+static uint32_t led_matrix_div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
 
-    // Is this task active?
-    bool loader_on = comm->data.led_matrix.loader.active;
-    if (!loader_on) {
-        return;
+int led_matrix_layer_configure(enum led_matrix_layer_id layer,
+                               enum led_matrix_blend blend, uint8_t opacity) {
+    if (layer >= N_LED_MATRIX_LAYERS || blend >= N_LED_MATRIX_BLENDS) {
+        return -EINVAL;
     }
 
-    int cur_row = comm->data.led_matrix.loader.row;
-    int cur_col = comm->data.led_matrix.loader.col;
-    enum animation_map input_anim = comm->data.led_matrix.loader.input_anim;
-    int input_frame = comm->data.led_matrix.loader.input_frame;
-    int output_slot = comm->data.led_matrix.loader.output_slot;
+    struct led_matrix_layer *entry = &led_matrix_context.layers[layer];
+    if (entry->blend != blend || entry->opacity != opacity) {
+        entry->blend = blend;
+        entry->opacity = opacity;
+        entry->dirty = true;
+        entry->submitted = true;
+    }
 
-    struct led_matrix *output = get_matrix_entry(context, output_slot);
-    struct led_matrix *input = animation_map_values[input_anim];
+    return 0;
+}
 
-    // Copy a single led over pre frame. This matches the rate of the renderer
-    output->mat[cur_row][cur_col] = input[input_frame].mat[cur_row][cur_col];
+int led_matrix_layer_enable(enum led_matrix_layer_id layer, bool enable) {
+    if (layer >= N_LED_MATRIX_LAYERS) {
+        return -EINVAL;
+    }
 
-    // Update index values
-    cur_col++;
-    if (cur_col >= N_DIMENSIONS) {
-        cur_col = 0;
-        cur_row++;
+    led_matrix_context.layers[layer].enabled = enable;
+
+    return 0;
+}
+
+int led_matrix_layer_update(enum led_matrix_layer_id layer,
+                            const struct led_matrix *frame) {
+    if (layer >= N_LED_MATRIX_LAYERS) {
+        return -EINVAL;
     }
-    if (cur_row >= N_DIMENSIONS) {
-        cur_row = 0;
 
-        // We finished, so request a new frame to load
-        comm->data.led_matrix.loader.finished = true;
-        update_requested = true;
+    struct led_matrix_layer *entry = &led_matrix_context.layers[layer];
+    if (memcmp(entry->cache.mat, frame->mat, sizeof(entry->cache.mat)) != 0) {
+        memcpy(entry->cache.mat, frame->mat, sizeof(entry->cache.mat));
+        entry->dirty = true;
     }
+    entry->submitted = true;
+    entry->stamp = job_queue_timestamp();
 
-    // Update values
-    comm->data.led_matrix.loader.row = cur_row;
-    comm->data.led_matrix.loader.col = cur_col;
+    return 0;
 }
 
-void led_matrix_renderer_run(void) {
+static bool led_matrix_layer_source_active(struct led_matrix_context *context,
+                                           enum led_matrix_layer_id layer) {
+    switch (layer) {
+        case LED_MATRIX_LAYER_ANIMATION:
+            return job_group_is_enabled(JOB_GROUP_LED_LOADER) &&
+                   context->comm->data.led_matrix.loader.active;
+        case LED_MATRIX_LAYER_SPRITES:
+            return job_group_is_enabled(JOB_GROUP_LED_RENDERER) &&
+                   context->comm->data.led_matrix.renderer.active;
+        default:
+            return true;
+    }
+}
+
+/* A layer is only shown while it is enabled and its source stage is on */
+static uint32_t led_matrix_layer_mask(struct led_matrix_context *context) {
+    uint32_t mask = 0;
+
+    for (int n = 0; n < N_LED_MATRIX_LAYERS; n++) {
+        if (context->layers[n].enabled &&
+            led_matrix_layer_source_active(context, n)) {
+            mask |= 1U << n;
+        }
+    }
+
+    return mask;
+}
+
+/* Blends `layer` onto `output`, see enum led_matrix_blend */
+static void led_matrix_layer_blend(struct led_matrix *output,
+                                   const struct led_matrix_layer *layer) {
+    const uint8_t *src = &layer->cache.mat[0][0];
+    uint8_t *dst = &output->mat[0][0];
+    uint32_t opacity = layer->opacity;
+
+    for (size_t i = 0; i < sizeof(output->mat); i++) {
+        uint32_t value = led_matrix_div255(src[i] * opacity);
+
+        switch (layer->blend) {
+            case LED_MATRIX_BLEND_ADD:
+                value += dst[i];
+                break;
+            case LED_MATRIX_BLEND_MAX:
+                value = value > dst[i] ? value : dst[i];
+                break;
+            case LED_MATRIX_BLEND_REPLACE:
+                value += led_matrix_div255(
+                    dst[i] * (LED_MATRIX_OPACITY_OPAQUE - opacity));
+                break;
+            default:
+                break;
+        }
+
+        dst[i] = value > LED_MATRIX_MAX_BRIGHTNESS ? LED_MATRIX_MAX_BRIGHTNESS
+                                                   : value;
+    }
+}
+
+void led_matrix_loader_run(void) {
     struct led_matrix_context *context = &led_matrix_context;
     struct driver_comm_shared_memory *comm = context->comm;
 
     // Is this task active?
-    bool renderer_on = comm->data.led_matrix.renderer.active;
-    if (!renderer_on) {
+    bool loader_on = comm->data.led_matrix.loader.active;
+    if (!loader_on) {
         return;
     }
 
-    int cur_row = comm->data.led_matrix.renderer.row;
-    int cur_col = comm->data.led_matrix.renderer.col;
-    int output_slot = comm->data.led_matrix.renderer.output_slot;
-    struct game_entity *input = comm->data.led_matrix.renderer.entities;
-    uint32_t num_entities = comm->data.led_matrix.renderer.num_entities;
+    enum animation_map input_anim = comm->data.led_matrix.loader.input_anim;
+    int input_frame = comm->data.led_matrix.loader.input_frame;
+    const struct packed_animation *packed = animation_map_packed[input_anim];
+    struct led_matrix frame;
+
+    // Plain frames are volatile, so both paths hand over a local copy
+    if (packed != NULL) {
+        packed_animation_decode(&context->cursor, packed, input_frame, &frame);
+    } else {
+        frame = animation_map_values[input_anim][input_frame];
+    }
+    led_matrix_layer_update(LED_MATRIX_LAYER_ANIMATION, &frame);
 
-    struct led_matrix *output = get_matrix_entry(context, output_slot);
+    // We finished, so request a new frame to load
+    comm->data.led_matrix.loader.finished = true;
+    update_requested = true;
+}
 
+#if LED_MATRIX_RENDER_MODE == LED_MATRIX_RENDER_PIXEL
+/*
+ * Renders the single pixel at `cur_row`, `cur_col` from every active sprite
+ * that overlaps it.
+ */
+static void led_matrix_render_pixel(struct led_matrix *output,
+                                    struct game_entity *input,
+                                    uint32_t num_entities, int cur_row,
+                                    int cur_col) {
     // First, reset the pixel
     output->mat[cur_row][cur_col] = 0;
 
@@ -174,12 +375,158 @@ void led_matrix_renderer_run(void) {
                     (int)(brightness * overlap_area);
 
                 // Clamp the pixel brightness to the maximum value
-                if (output->mat[cur_row][cur_col] > 4) {
-                    output->mat[cur_row][cur_col] = 4;
+                if (output->mat[cur_row][cur_col] >
+                    LED_MATRIX_MAX_BRIGHTNESS) {
+                    output->mat[cur_row][cur_col] = LED_MATRIX_MAX_BRIGHTNESS;
                 }
             }
         }
     }
+}
+#elif LED_MATRIX_RENDER_MODE == LED_MATRIX_RENDER_FRAME
+/*
+ * Renders the whole frame in one call. Each active sprite is clipped to the
+ * matrix and added into the output with saturation, so the cost is the
+ * total visible sprite area in integer math only.
+ */
+static void led_matrix_render_frame(struct led_matrix *output,
+                                    struct game_entity *input,
+                                    uint32_t num_entities) {
+    memset(output->mat, 0, sizeof(output->mat));
+
+    for (uint32_t i = 0; i < num_entities; i++) {
+        if (!game_entity_is_active(&input[i])) {
+            continue;
+        }
+
+        struct sprite_component *sc = &input[i].sprite;
+        const struct sprite *sprite = sc->map;
+        int width = sprite->width;
+        int height = sprite->height;
+
+        // Clip the sprite bounds to the matrix
+        int x1 = CLAMP(sc->x, 0, N_DIMENSIONS);
+        int y1 = CLAMP(sc->y, 0, N_DIMENSIONS);
+        int x2 = CLAMP(sc->x + width, 0, N_DIMENSIONS);
+        int y2 = CLAMP(sc->y + height, 0, N_DIMENSIONS);
+
+        for (int row = y1; row < y2; row++) {
+            const uint8_t *src =
+                &sprite->data[(row - sc->y) * width + (x1 - sc->x)];
+            uint8_t *dst = &output->mat[row][x1];
+
+            for (int col = x1; col < x2; col++) {
+                uint32_t value = *dst + *src++;
+                *dst++ = value > LED_MATRIX_MAX_BRIGHTNESS
+                             ? LED_MATRIX_MAX_BRIGHTNESS
+                             : value;
+            }
+        }
+    }
+}
+#else
+/* Adds `value` to the led at `row`, `col` if it is on the matrix */
+static inline void led_matrix_accumulate(
+    uint16_t acc[N_DIMENSIONS][N_DIMENSIONS], int row, int col,
+    uint32_t value) {
+    if ((unsigned)row < N_DIMENSIONS && (unsigned)col < N_DIMENSIONS) {
+        acc[row][col] += value;
+    }
+}
+
+/*
+ * Renders the whole frame in one call with each sprite placed to a fraction
+ * of an led. A sprite's position is split into the led its top left corner
+ * is on and how far into that led it is. Each sprite pixel then lands on up
+ * to four leds, weighted by how much of each it covers out of
+ * SPRITE_SUBPIXELS squared. The weights are the same for every pixel of a
+ * sprite so they are only worked out once per sprite, and everything stays
+ * in integer math.
+ */
+static void led_matrix_render_subpixel(struct led_matrix *output,
+                                       struct game_entity *input,
+                                       uint32_t num_entities) {
+    // Brightness times area, 16 bits holds 63 full brightness overlaps
+    uint16_t acc[N_DIMENSIONS][N_DIMENSIONS] = {0};
+
+    for (uint32_t i = 0; i < num_entities; i++) {
+        if (!game_entity_is_active(&input[i])) {
+            continue;
+        }
+
+        struct sprite_component *sc = &input[i].sprite;
+        const struct sprite *sprite = sc->map;
+        int width = sprite->width;
+        int height = sprite->height;
+
+        // Split the position into a whole led and the subpixels into it
+        int x = sc->x * SPRITE_SUBPIXELS + sc->x_frac;
+        int y = sc->y * SPRITE_SUBPIXELS + sc->y_frac;
+        int col0 = x >> SPRITE_SUBPIXEL_BITS;
+        int row0 = y >> SPRITE_SUBPIXEL_BITS;
+        uint32_t fx = x & (SPRITE_SUBPIXELS - 1);
+        uint32_t fy = y & (SPRITE_SUBPIXELS - 1);
+
+        // Area of the led at each offset covered by one sprite pixel
+        const uint32_t weight[2][2] = {
+            {(SPRITE_SUBPIXELS - fx) * (SPRITE_SUBPIXELS - fy),
+             fx * (SPRITE_SUBPIXELS - fy)},
+            {(SPRITE_SUBPIXELS - fx) * fy, fx * fy},
+        };
+
+        for (int row = 0; row < height; row++) {
+            for (int col = 0; col < width; col++) {
+                uint32_t value = sprite->data[row * width + col];
+                if (value == 0) {
+                    continue;
+                }
+
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        if (weight[dy][dx] != 0) {
+                            led_matrix_accumulate(acc, row0 + row + dy,
+                                                  col0 + col + dx,
+                                                  value * weight[dy][dx]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Round back to a brightness level and saturate
+    const uint32_t half = SPRITE_SUBPIXELS * SPRITE_SUBPIXELS / 2;
+    for (int row = 0; row < N_DIMENSIONS; row++) {
+        for (int col = 0; col < N_DIMENSIONS; col++) {
+            uint32_t value =
+                (acc[row][col] + half) >> (2 * SPRITE_SUBPIXEL_BITS);
+            output->mat[row][col] = value > LED_MATRIX_MAX_BRIGHTNESS
+                                        ? LED_MATRIX_MAX_BRIGHTNESS
+                                        : value;
+        }
+    }
+}
+#endif
+
+void led_matrix_renderer_run(void) {
+    struct led_matrix_context *context = &led_matrix_context;
+    struct driver_comm_shared_memory *comm = context->comm;
+
+    // Is this task active?
+    bool renderer_on = comm->data.led_matrix.renderer.active;
+    if (!renderer_on) {
+        return;
+    }
+
+    int cur_row = comm->data.led_matrix.renderer.row;
+    int cur_col = comm->data.led_matrix.renderer.col;
+    struct game_entity *input = comm->data.led_matrix.renderer.entities;
+    uint32_t num_entities = comm->data.led_matrix.renderer.num_entities;
+
+    struct led_matrix *output = &context->render_scratch;
+
+#if LED_MATRIX_RENDER_MODE == LED_MATRIX_RENDER_PIXEL
+    led_matrix_render_pixel(output, input, num_entities, cur_row, cur_col);
 
     // Update index values
     cur_col++;
@@ -187,10 +534,25 @@ void led_matrix_renderer_run(void) {
         cur_col = 0;
         cur_row++;
     }
+#elif LED_MATRIX_RENDER_MODE == LED_MATRIX_RENDER_FRAME
+    led_matrix_render_frame(output, input, num_entities);
+
+    cur_col = 0;
+    cur_row = N_DIMENSIONS;
+#else
+    led_matrix_render_subpixel(output, input, num_entities);
+
+    cur_col = 0;
+    cur_row = N_DIMENSIONS;
+#endif
+
     if (cur_row >= N_DIMENSIONS) {
         cur_row = 0;
 
-        // We finished, so request a new slot to render to
+        // We finished, so hand the frame over and request a new one
+        led_matrix_layer_update(LED_MATRIX_LAYER_SPRITES, output);
+        context->layers[LED_MATRIX_LAYER_SPRITES].stamp =
+            display_telemetry_frame_rendered();
         comm->data.led_matrix.renderer.finished = true;
         update_requested = true;
     }
@@ -200,6 +562,57 @@ void led_matrix_renderer_run(void) {
     comm->data.led_matrix.renderer.col = cur_col;
 }
 
+void led_matrix_compositor_run(void) {
+    struct led_matrix_context *context = &led_matrix_context;
+    uint32_t mask = led_matrix_layer_mask(context);
+    bool dirty = !context->composed_valid || mask != context->composed_mask;
+    uint32_t stamp = job_queue_timestamp();
+
+    int slot = led_matrix_ring_acquire(context);
+    if (slot < 0) {
+        return;
+    }
+
+    /*
+     * The frame is stamped with the oldest frame handed over by a shown
+     * layer, or with the commit time if only the layer mask changed.
+     */
+    for (int n = 0; n < N_LED_MATRIX_LAYERS; n++) {
+        if (mask & (1U << n)) {
+            dirty |= context->layers[n].dirty;
+            if (context->layers[n].submitted &&
+                (int32_t)(context->layers[n].stamp - stamp) < 0) {
+                stamp = context->layers[n].stamp;
+            }
+        }
+        context->layers[n].dirty = false;
+        context->layers[n].submitted = false;
+    }
+
+    // Only blend again if a shown layer changed since the last frame
+    if (dirty) {
+        memset(context->composed.mat, 0, sizeof(context->composed.mat));
+        for (int n = 0; n < N_LED_MATRIX_LAYERS; n++) {
+            if (mask & (1U << n)) {
+                led_matrix_layer_blend(&context->composed,
+                                       &context->layers[n]);
+            }
+        }
+        context->composed_hash = led_matrix_hash(&context->composed);
+        context->composed_mask = mask;
+        context->composed_valid = true;
+    }
+
+    /*
+     * An unchanged frame is still committed so the sources stay paced by
+     * the display, the assembler skips it by its hash.
+     */
+    *get_matrix_entry(context, slot) = context->composed;
+    context->matrix_hash[slot] = context->composed_hash;
+    display_telemetry_frame_committed(slot, stamp);
+    led_matrix_ring_commit(context);
+}
+
 void led_matrix_assembler_run(void) {
     struct led_matrix_context *context = &led_matrix_context;
     struct driver_comm_shared_memory *comm = context->comm;
@@ -210,43 +623,124 @@ void led_matrix_assembler_run(void) {
         return;
     }
 
-    int cur_row = comm->data.led_matrix.assembler.row;
-    int cur_col = comm->data.led_matrix.assembler.col;
-    int input_slot = comm->data.led_matrix.assembler.input_slot;
+    // Start on the oldest frame in the ring, if there is one
+    int slot = led_matrix_ring_peek(context);
+    if (slot < 0) {
+        return;
+    }
+    comm->data.led_matrix.assembler.input_slot = slot;
+
+    int input_slot = slot;
     int output_slot = comm->data.led_matrix.assembler.output_slot;
 
     struct led_matrix *input = get_matrix_entry(context, input_slot);
     struct frame_instance *output = get_frame_entry(context, output_slot);
 
-    // We need the index of the led so we can assign that element to itself
-    int index = (cur_row * N_DIMENSIONS) + cur_col + 1;
+    /*
+     * If the frame is the one already on display there is nothing to
+     * assemble or hand to the driver, so finish it straight away.
+     */
+    if (context->displayed_valid &&
+        context->matrix_hash[input_slot] == context->displayed_hash) {
+        context->frame_stats.n_skipped++;
+        display_telemetry_frame_drawn(input_slot);
+        led_matrix_ring_release(context);
+        comm->data.led_matrix.assembler.finished = true;
+        return;
+    }
 
-    // Get the value for this led
-    uint32_t led = input->mat[cur_row][cur_col];
+    // Pack the whole frame into bit-planes, the driver works a word at a time
+    charlieplex_planes_pack(&output->planes, &input->mat[0][0]);
+    charlieplex_driver_draw_planes(&output->planes);
+    display_telemetry_frame_drawn(input_slot);
+    led_matrix_ring_release(context);
 
-    if (led) {
-        output->frame.matrix[index] = index;  // 1U;
-    } else {
-        output->frame.matrix[index] = 0U;
+    context->displayed_hash = context->matrix_hash[input_slot];
+    context->displayed_valid = true;
+    context->frame_stats.n_processed++;
+
+    // Finished so request new data
+    comm->data.led_matrix.assembler.finished = true;
+    comm->data.led_matrix.assembler.row = 0;
+    comm->data.led_matrix.assembler.col = 0;
+}
+
+/*
+ * A source has work to do while it is active, the widget controller has
+ * consumed its last finished frame and the compositor has taken the last
+ * frame it handed over. The compositor has work while the ring has room and
+ * a layer was handed a frame or turned on or off.
+ */
+bool led_matrix_loader_is_ready(void) {
+    return led_matrix_comm.data.led_matrix.loader.active &&
+           !led_matrix_comm.data.led_matrix.loader.finished &&
+           !led_matrix_context.layers[LED_MATRIX_LAYER_ANIMATION].submitted;
+}
+
+bool led_matrix_renderer_is_ready(void) {
+    return led_matrix_comm.data.led_matrix.renderer.active &&
+           !led_matrix_comm.data.led_matrix.renderer.finished &&
+           !led_matrix_context.layers[LED_MATRIX_LAYER_SPRITES].submitted;
+}
+
+bool led_matrix_compositor_is_ready(void) {
+    struct led_matrix_context *context = &led_matrix_context;
+
+    if (led_matrix_ring_occupancy(context) >= LED_MATRIX_BUFFER_SIZE) {
+        return false;
     }
 
-    // Update index values
-    cur_col++;
-    if (cur_col >= N_DIMENSIONS) {
-        cur_col = 0;
-        cur_row++;
+    if (!context->composed_valid ||
+        led_matrix_layer_mask(context) != context->composed_mask) {
+        return true;
     }
-    if (cur_row >= N_DIMENSIONS) {
-        cur_row = 0;
 
-        // Finished so request new data
-        comm->data.led_matrix.assembler.finished = true;
-        charlieplex_driver_draw(output->frame.matrix);
+    for (int n = 0; n < N_LED_MATRIX_LAYERS; n++) {
+        if (context->layers[n].submitted) {
+            return true;
+        }
     }
 
-    // Update values
-    comm->data.led_matrix.assembler.row = cur_row;
-    comm->data.led_matrix.assembler.col = cur_col;
+    return false;
+}
+
+bool led_matrix_assembler_is_ready(void) {
+    struct led_matrix_context *context = &led_matrix_context;
+
+    if (!led_matrix_comm.data.led_matrix.assembler.active ||
+        led_matrix_comm.data.led_matrix.assembler.finished) {
+        return false;
+    }
+
+    /*
+     * Hold the ring until the driver has shown its frame, a newer one would
+     * only replace it unseen. The ring then fills up and holds back the
+     * compositor and the sources to the display rate.
+     */
+    if (charlieplex_driver_is_pending()) {
+        return false;
+    }
+
+    // Count each stretch of waiting on an empty ring once
+    if (led_matrix_ring_occupancy(context) == 0) {
+        if (!context->starved) {
+            context->starved = true;
+            context->frame_stats.n_underruns++;
+        }
+        return false;
+    }
+
+    context->starved = false;
+    return true;
+}
+
+void led_matrix_get_frame_stats(struct led_matrix_frame_stats *stats) {
+    *stats = led_matrix_context.frame_stats;
+    stats->occupancy = led_matrix_ring_occupancy(&led_matrix_context);
+}
+
+void led_matrix_reset_frame_stats(void) {
+    led_matrix_context.frame_stats = (struct led_matrix_frame_stats){0};
 }
 
 void pause_led_matrix() {
@@ -257,44 +751,34 @@ void unpause_led_matrix() {
 }
 
 size_t led_matrix_scroll_text(const char *text, enum scroll_speed speed) {
+    static struct scroll_text scroll;
     static size_t scroll_position = 0;
-    static char prev_text[16];
     static bool busy = false;
 
-    if (busy) {
-        if (strcmp(text, prev_text) != 0) {
-            strncpy(prev_text, text, sizeof(prev_text));
-            scroll_position = 0;
+    // The text is only rasterised again when it changes
+    if (scroll_text_set(&scroll, text)) {
+        if (busy) {
             LOG_INF("Warning: scroll text interrupted by new text");
         }
-    } else {
-        busy = true;
-        strncpy(prev_text, text, sizeof(prev_text));
-    }
-
-    led_matrix_comm.data.led_matrix.renderer.active = false;
-    led_matrix_comm.data.led_matrix.renderer.finished = true;
-    led_matrix_comm.data.led_matrix.loader.active = true;
-    led_matrix_comm.data.led_matrix.loader.finished = true;
-    led_matrix_comm.data.led_matrix.loader.input_anim = ANIM_RUNTIME_ANIMATION;
-
-    if (led_matrix_comm.data.led_matrix.loader.finished) {
-        generate_frame(text, strlen(text), scroll_position++ / speed,
-                       animation_map_values[ANIM_RUNTIME_ANIMATION][0].mat);
-
-        if (scroll_position >= strlen(text) * (N_DIMENSIONS * speed)) {
-            scroll_position = 0;
-            busy = false;
-            led_matrix_comm.data.led_matrix.loader.active = false;
-            led_matrix_comm.data.led_matrix.loader.finished = true;
-            led_matrix_comm.data.led_matrix.renderer.active = true;
-            led_matrix_comm.data.led_matrix.renderer.finished = true;
-            led_matrix_comm.data.led_matrix.renderer.row = 0;
-            led_matrix_comm.data.led_matrix.renderer.col = 0;
-
-            return 0;
-        }
+        scroll_position = 0;
+    }
+    busy = true;
+
+    size_t len = scroll.len;
+
+    // The text is drawn over the other layers, which keep running below it
+    struct led_matrix frame;
+    scroll_text_window(&scroll, scroll_position++ / speed, frame.mat);
+    led_matrix_layer_update(LED_MATRIX_LAYER_TEXT, &frame);
+    led_matrix_layer_enable(LED_MATRIX_LAYER_TEXT, true);
+
+    if (scroll_position >= scroll_text_n_columns(&scroll) * speed) {
+        scroll_position = 0;
+        busy = false;
+        led_matrix_layer_enable(LED_MATRIX_LAYER_TEXT, false);
+
+        return 0;
     }
 
-    return strlen(text) * (N_DIMENSIONS << speed) - scroll_position;
+    return len * (N_DIMENSIONS << speed) - scroll_position;
 }
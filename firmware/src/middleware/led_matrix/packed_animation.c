@@ -0,0 +1,78 @@
+#include "packed_animation.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define N_LEDS (N_DIMENSIONS * N_DIMENSIONS)
+
+static void decode_key_frame(const uint8_t *data, uint8_t *leds) {
+    uint32_t bits = 0;
+    int n_bits = 0;
+
+    for (int i = 0; i < N_LEDS; i++) {
+        if (n_bits < 3) {
+            bits |= (uint32_t)*data++ << n_bits;
+            n_bits += 8;
+        }
+        leds[i] = bits & 0x7U;
+        bits >>= 3;
+        n_bits -= 3;
+    }
+}
+
+static void decode_delta_frame(const uint8_t *data, const uint8_t *end,
+                               uint8_t *leds) {
+    int pos = 0;
+
+    while (data < end) {
+        uint8_t token = *data++;
+        uint8_t value = token & 0x7U;
+
+        pos += token >> 3;
+        if (value != PACKED_ANIMATION_SKIP && pos < N_LEDS) {
+            leds[pos++] = value;
+        }
+    }
+}
+
+static void decode_frame(const struct packed_animation *anim,
+                         uint32_t frame_n, uint8_t *leds) {
+    uint16_t entry = anim->index[frame_n];
+    const uint8_t *data =
+        &anim->data[entry & PACKED_ANIMATION_OFFSET_MASK];
+    const uint8_t *end =
+        &anim->data[anim->index[frame_n + 1] & PACKED_ANIMATION_OFFSET_MASK];
+
+    if (entry & PACKED_ANIMATION_KEY_FRAME) {
+        decode_key_frame(data, leds);
+    } else {
+        decode_delta_frame(data, end, leds);
+    }
+}
+
+int packed_animation_decode(struct packed_animation_cursor *cursor,
+                            const struct packed_animation *anim,
+                            uint32_t frame_n, struct led_matrix *out) {
+    if (frame_n >= anim->n_frames) {
+        return -EINVAL;
+    }
+
+    // Out of order, so replay from the nearest key frame at or before it
+    if (cursor->anim != anim || cursor->next_frame > frame_n) {
+        uint32_t key = frame_n;
+        while (key > 0 && !(anim->index[key] & PACKED_ANIMATION_KEY_FRAME)) {
+            key--;
+        }
+        cursor->anim = anim;
+        cursor->next_frame = key;
+    }
+
+    while (cursor->next_frame <= frame_n) {
+        decode_frame(anim, cursor->next_frame, &cursor->frame.mat[0][0]);
+        cursor->next_frame++;
+    }
+
+    memcpy(out->mat, cursor->frame.mat, sizeof(out->mat));
+
+    return 0;
+}
@@ -335,6 +335,85 @@ const uint8_t* get_char_5x5(char c) {
     }
 }
 
+bool scroll_text_set(struct scroll_text* scroll, const char* text) {
+    // FNV-1a, measuring the length in the same pass
+    uint32_t hash = 2166136261U;
+    size_t len = 0;
+
+    for (; text[len] != '\0'; len++) {
+        hash = (hash ^ (uint8_t)text[len]) * 16777619U;
+    }
+
+    scroll->text = text;
+    if (hash == scroll->hash && len == scroll->len) {
+        return false;
+    }
+
+    scroll->len = len;
+    scroll->hash = hash;
+    scroll->strip_char = 0;
+    scroll->next_char = 0;
+
+    return true;
+}
+
+// Transposes a character into its columns of the strip
+static void scroll_text_rasterise_char(struct scroll_text* scroll,
+                                       size_t char_index) {
+    const uint8_t* char_pattern =
+        char_index < scroll->len ? get_char_5x5(scroll->text[char_index])
+                                 : NULL;
+
+    for (int col = 0; col < SCROLL_TEXT_CHAR_WIDTH; ++col) {
+        uint8_t bits = 0;
+
+        if (char_pattern != NULL && col < 5) {
+            // Centered in the middle 5 rows of the 7x7 matrix (rows 1 to 5)
+            for (int row = 0; row < 5; ++row) {
+                if (char_pattern[row] & (1 << (4 - col))) {
+                    bits |= 1 << (row + 1);
+                }
+            }
+        }
+
+        scroll->strip[(char_index * SCROLL_TEXT_CHAR_WIDTH + col) %
+                      SCROLL_TEXT_STRIP_LEN] = bits;
+    }
+}
+
+void scroll_text_window(struct scroll_text* scroll, size_t column,
+                        uint8_t frame[7][7]) {
+    size_t first_char = column / SCROLL_TEXT_CHAR_WIDTH;
+    size_t last_char = (column + 6) / SCROLL_TEXT_CHAR_WIDTH;
+
+    // Start over if the window is not in or just after the strip
+    if (first_char < scroll->strip_char || first_char > scroll->next_char) {
+        scroll->strip_char = first_char;
+        scroll->next_char = first_char;
+    }
+
+    while (scroll->next_char <= last_char) {
+        scroll_text_rasterise_char(scroll, scroll->next_char++);
+    }
+
+    // Rasterising a character overwrites the one two before it
+    if (scroll->next_char - scroll->strip_char > 2) {
+        scroll->strip_char = scroll->next_char - 2;
+    }
+
+    memset(frame, 0, sizeof(uint8_t) * 7 * 7);
+
+    for (int col = 0; col < 7; ++col) {
+        uint8_t bits = scroll->strip[(column + col) % SCROLL_TEXT_STRIP_LEN];
+
+        for (int row = 0; bits != 0; ++row, bits >>= 1) {
+            if (bits & 1) {
+                frame[row][col] = SCROLL_TEXT_BRIGHTNESS;
+            }
+        }
+    }
+}
+
 // Function to generate a 7x7 matrix frame for the Charlieplex driver with
 // centered 5x5 characters
 void generate_frame(const char* text, size_t len, int scroll_position,
@@ -1,5 +1,6 @@
 #include "system_communication.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "i2c_driver.h"
@@ -44,3 +45,9 @@ void system_communication_setup(void) {
 void system_communication_run(void) {
     i2c_queue_process_one(&i2c1_context);
 }
+
+bool system_communication_is_pending(void) {
+    struct i2c_queue_context *queue_context = &i2c1_context.queue_context;
+    return queue_context->n_elts_used > 0 &&
+           atomic_load(&queue_context->i2c_bus_in_use) == I2C_FREE;
+}
@@ -1,7 +1,10 @@
 #include "widget_controller.h"
 
+#include "display_telemetry.h"
 #include "game_engine.h"
 #include "imp23absu_driver.h"
+#include "job_profiler.h"
+#include "job_queue.h"
 #include "led_matrix.h"
 #include "logging.h"
 #include "lsm6dsm_driver.h"
@@ -63,6 +66,14 @@ static void update_data(void);
 
 static void update_mode(void) {
     music_player_abort_song(&music_player);
+
+    // The microphone is used in FFT mode so the music player is switched off
+    if (context.mode == WIDGET_MODE_FFT) {
+        job_group_disable(JOB_GROUP_AUDIO);
+    } else {
+        job_group_enable(JOB_GROUP_AUDIO);
+    }
+
     switch (context.mode) {
         case WIDGET_MODE_PONG_GAME:
             set_game(PONG_GAME);
@@ -80,6 +91,15 @@ static void update_mode(void) {
             set_game(FFT_GAME);
             break;
     }
+
+    // Draw the game while it is running, otherwise play the animation
+    if (game_engine_get_current_game_state() == GAME_STATE_IN_PROGRESS) {
+        job_group_disable(JOB_GROUP_LED_LOADER);
+        job_group_enable(JOB_GROUP_LED_RENDERER);
+    } else {
+        job_group_disable(JOB_GROUP_LED_RENDERER);
+        job_group_enable(JOB_GROUP_LED_LOADER);
+    }
 }
 
 static void next_mode(void) {
@@ -92,22 +112,48 @@ static void previous_mode(void) {
     update_mode();
 }
 
-static struct entity ent = (struct entity){
-    .active = true,
-};
+/* A single entity environment, whose one entity is always active */
+static PHYSICS_ENGINE_ENVIRONMENT_STORAGE(1) placeholder_storage;
+static struct physics_engine_environment placeholder_environment;
 
 /*
- * Temporary array of entities until game engine is working
+ * Temporary array of entities until game engine is working. They share the
+ * placeholder entity, which is added in widget_controller_setup().
  */
 static struct game_entity entities[] = {
-    {.entity = &ent, .sprite = {.map = &vertical_paddle, .x = 0, .y = 0}},
-    {.entity = &ent, .sprite = {.map = &star, .x = 3, .y = 2}}};
+    {.sprite = {.map = &vertical_paddle, .x = 0, .y = 0}},
+    {.sprite = {.map = &star, .x = 3, .y = 2}}};
+
+static void placeholder_entities_setup(void) {
+    struct entity_init_struct init_struct = {
+        .rectangle = {{0, 0}, {1, 1}},
+        .mass = INFINITE_MASS,
+    };
+    struct entity_creation_result result;
+
+    PHYSICS_ENGINE_ENVIRONMENT_INIT(&placeholder_environment,
+                                    &placeholder_storage);
+
+    result = add_entity(&placeholder_environment, &init_struct);
+    if (result.error != ENTITY_CREATION_SUCCESS) {
+        LOG_ERR("Failed to create placeholder entity: %d", result.error);
+        return;
+    }
+    activate_entity(result.entity);
+
+    for (size_t n = 0; n < sizeof(entities) / sizeof(entities[0]); n++) {
+        entities[n].entity = result.entity;
+    }
+}
 
 void widget_controller_setup(void) {
     LOG_INF("[Widget controller initalization]");
 
-    // Turn on all led_matrix functions that we need
-    led_matrix_comm.data.led_matrix.loader.active = false;
+    /*
+     * Turn on all led_matrix functions that we need. Which of the loader and
+     * renderer runs is switched by their job groups in update_mode().
+     */
+    led_matrix_comm.data.led_matrix.loader.active = true;
     led_matrix_comm.data.led_matrix.renderer.active = true;
     led_matrix_comm.data.led_matrix.assembler.active = true;
     led_matrix_comm.data.led_matrix.drawer.active = false;
@@ -122,18 +168,16 @@ void widget_controller_setup(void) {
     led_matrix_comm.data.led_matrix.drawer.num_draws = NUM_LEDS;
 
     /*
-     * Set which slots to start in. For now, oscillate between first two slots
-     * And alternate which inputs and outputs match up so they don't overwrite
-     * each other
+     * The loader and renderer fill their compositor layers, the compositor
+     * and assembler pass frames through the ring. Only the assembled output
+     * still alternates between two.
      */
     led_matrix_comm.data.led_matrix.loader.input_frame = 0;
-    led_matrix_comm.data.led_matrix.loader.output_slot = 0;
-    led_matrix_comm.data.led_matrix.renderer.output_slot = 0;
-    led_matrix_comm.data.led_matrix.assembler.input_slot = 1;
     led_matrix_comm.data.led_matrix.assembler.output_slot = 0;
     led_matrix_comm.data.led_matrix.drawer.input_slot = 1;
 
     // Update values for the renderer
+    placeholder_entities_setup();
     led_matrix_comm.data.led_matrix.renderer.entities = entities;
     led_matrix_comm.data.led_matrix.renderer.num_entities =
         sizeof(entities) / sizeof(struct game_entity);
@@ -143,13 +187,6 @@ void widget_controller_setup(void) {
 }
 
 void widget_controller_run(void) {
-    enum led_matrix_function {
-        LED_MATRIX_LOADER,
-        LED_MATRIX_ASSEMBLER,
-        LED_MATRIX_RENDERER,
-        LED_MATRIX_DRAWER,
-    };
-    static bool led_matrix_previous_state[4] = {false, false, false, false};
     switch (context.state) {
         case WIDGET_PREINIT: {
             update_mode();
@@ -165,15 +202,12 @@ void widget_controller_run(void) {
             tap_flags tap_flags = lsm6dsm_driver_get_tap_flags(lsm6dsm);
             if (tap_flags.double_tap && tap_flags.y_tap) {
                 next_mode();
+            }
 
-                if (game_engine_get_current_game_state() ==
-                    GAME_STATE_IN_PROGRESS) {
-                    led_matrix_comm.data.led_matrix.loader.active = false;
-                    led_matrix_comm.data.led_matrix.renderer.active = true;
-                } else {
-                    led_matrix_comm.data.led_matrix.loader.active = true;
-                    led_matrix_comm.data.led_matrix.renderer.active = false;
-                }
+            // Double tapping the face dumps the debug statistics to the uart
+            if (tap_flags.double_tap && tap_flags.z_tap) {
+                job_profiler_dump();
+                display_telemetry_dump();
             }
 
             lsm6dsm_driver_clear_tap_flags(lsm6dsm);
@@ -190,21 +224,8 @@ void widget_controller_run(void) {
                 LOG_INF("[Entering Low Power Mode]");
                 context.state = WIDGET_ENTER_LP1;
 
-                /* Store previous function states */
-                led_matrix_previous_state[LED_MATRIX_LOADER] =
-                    led_matrix_comm.data.led_matrix.loader.active;
-                led_matrix_previous_state[LED_MATRIX_ASSEMBLER] =
-                    led_matrix_comm.data.led_matrix.assembler.active;
-                led_matrix_previous_state[LED_MATRIX_RENDERER] =
-                    led_matrix_comm.data.led_matrix.renderer.active;
-                led_matrix_previous_state[LED_MATRIX_DRAWER] =
-                    led_matrix_comm.data.led_matrix.drawer.active;
-
-                // Turn off led matrix functions
-                led_matrix_comm.data.led_matrix.loader.active = false;
-                led_matrix_comm.data.led_matrix.renderer.active = false;
-                led_matrix_comm.data.led_matrix.assembler.active = false;
-                led_matrix_comm.data.led_matrix.drawer.active = false;
+                // Stop the frame pipeline, its active flags are left as is
+                job_group_disable(JOB_GROUP_DISPLAY | JOB_GROUP_GAME);
             }
         } break;
 
@@ -310,15 +331,8 @@ void widget_controller_run(void) {
 
                 unpause_game_engine();
 
-                /* Restore previous function states */
-                led_matrix_comm.data.led_matrix.loader.active =
-                    led_matrix_previous_state[LED_MATRIX_LOADER];
-                led_matrix_comm.data.led_matrix.assembler.active =
-                    led_matrix_previous_state[LED_MATRIX_ASSEMBLER];
-                led_matrix_comm.data.led_matrix.renderer.active =
-                    led_matrix_previous_state[LED_MATRIX_RENDERER];
-                led_matrix_comm.data.led_matrix.drawer.active =
-                    led_matrix_previous_state[LED_MATRIX_DRAWER];
+                // Pick the frame pipeline back up where it left off
+                job_group_enable(JOB_GROUP_DISPLAY | JOB_GROUP_GAME);
 
                 unpause_led_matrix();
 
@@ -340,6 +354,7 @@ static void set_all_no_request(void) {
     acceleration_comm.request.type = REQUEST_TYPE_NONE;
     ambient_light_comm.request.status = REQUEST_STATUS_UNSEEN;
     ambient_light_comm.request.type = REQUEST_TYPE_NONE;
+    job_event_post(JOB_EVENT_SENSOR_REQUEST);
 }
 
 static void set_all_enter_lp(void) {
@@ -347,12 +362,14 @@ static void set_all_enter_lp(void) {
     acceleration_comm.request.type = REQUEST_TYPE_ENTER_LP;
     ambient_light_comm.request.status = REQUEST_STATUS_UNSEEN;
     ambient_light_comm.request.type = REQUEST_TYPE_ENTER_LP;
+    job_event_post(JOB_EVENT_SENSOR_REQUEST);
 }
 static void set_all_exit_lp(void) {
     acceleration_comm.request.status = REQUEST_STATUS_UNSEEN;
     acceleration_comm.request.type = REQUEST_TYPE_EXIT_LP;
     ambient_light_comm.request.status = REQUEST_STATUS_UNSEEN;
     ambient_light_comm.request.type = REQUEST_TYPE_EXIT_LP;
+    job_event_post(JOB_EVENT_SENSOR_REQUEST);
 }
 
 static void update_led_matrix(void) {
@@ -373,26 +390,16 @@ static void update_led_matrix(void) {
                 led_matrix_comm.data.led_matrix.loader.input_anim)) {
             led_matrix_comm.data.led_matrix.loader.input_frame = 0;
         }
-
-        // For now, alternate between first two slots
-        led_matrix_comm.data.led_matrix.loader.output_slot++;
-        led_matrix_comm.data.led_matrix.loader.output_slot &= 1;
     }
 
     if (led_matrix_comm.data.led_matrix.renderer.finished) {
         led_matrix_comm.data.led_matrix.renderer.finished = false;
-
-        // For now, alternate between first two slots
-        led_matrix_comm.data.led_matrix.renderer.output_slot++;
-        led_matrix_comm.data.led_matrix.renderer.output_slot &= 1;
     }
 
     if (led_matrix_comm.data.led_matrix.assembler.finished) {
         led_matrix_comm.data.led_matrix.assembler.finished = false;
 
-        // Alternate between first two slots
-        led_matrix_comm.data.led_matrix.assembler.input_slot++;
-        led_matrix_comm.data.led_matrix.assembler.input_slot &= 1;
+        // Alternate between the two assembled frames
         led_matrix_comm.data.led_matrix.assembler.output_slot++;
         led_matrix_comm.data.led_matrix.assembler.output_slot &= 1;
     }
@@ -423,6 +430,7 @@ static void update_data(void) {
         acceleration_comm.request.status = REQUEST_STATUS_UNSEEN;
         acceleration_comm.request.type = REQUEST_TYPE_DATA;
         acceleration_comm.timing.last_time = HAL_GetTick();
+        job_event_post(JOB_EVENT_SENSOR_REQUEST);
     }
 
     if (request_is_finished(&ambient_light_comm)) {
@@ -439,5 +447,6 @@ static void update_data(void) {
         ambient_light_comm.request.status = REQUEST_STATUS_UNSEEN;
         ambient_light_comm.request.type = REQUEST_TYPE_DATA;
         ambient_light_comm.timing.last_time = HAL_GetTick();
+        job_event_post(JOB_EVENT_SENSOR_REQUEST);
     }
 }
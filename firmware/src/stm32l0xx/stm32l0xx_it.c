@@ -1,5 +1,6 @@
 #include "stm32l0xx_it.h"
 
+#include "job_queue.h"
 #include "logging.h"
 #include "lsm6dsm_driver.h"
 #include "music_player.h"
@@ -48,10 +49,13 @@ void EXTI4_15_IRQHandler(void) {
 void HAL_GPIO_EXTI_Callback(uint16_t pin) {
     if (pin == GPIO_PIN_5) {
         vcnl4020_interrupt_flag = 1;
+        job_event_post(JOB_EVENT_AMBIENT_LIGHT_IT);
     } else if (pin == GPIO_PIN_6) {
         lsm6dsm_driver_set_int1(lsm6dsm);
+        job_event_post(JOB_EVENT_ACCELERATION_IT);
     } else if (pin == GPIO_PIN_7) {
         lsm6dsm_driver_set_int2(lsm6dsm);
+        job_event_post(JOB_EVENT_ACCELERATION_IT);
     }
 }
 
@@ -79,4 +83,5 @@ void DMA1_Channel2_3_IRQHandler(void) {
 void USART2_IRQHandler(void) {
     HAL_UART_IRQHandler(&uart);
     uart_busy = false;
+    job_event_post(JOB_EVENT_UART);
 }
\ No newline at end of file